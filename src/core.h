@@ -5,5 +5,7 @@
 #include "core/OperationMetadata.h"
 #include "core/OutputWrapper.h"
 #include "core/ParallelWorker.h"
+#include "core/RowTile.h"
+#include "core/WorkerScratch.h"
 
 #endif // WISEROW_CORE_H_
@@ -8,6 +8,7 @@
 
 #include <boost/utility/string_ref.hpp>
 #include <boost/variant/variant.hpp>
+#include <Rcpp.h>
 
 #include "OperationMetadata.h"
 
@@ -15,6 +16,240 @@ namespace wiserow {
 
 typedef boost::variant<int, double, boost::string_ref, std::complex<double>> supported_col_t;
 
+// =================================================================================================
+// strings are kept as the CHARSXPs stored in the STRSXP, logicals are ColumnType::INTEGER + flag,
+// factors that should be treated as characters keep their codes and levels, see FactorColumn
+
+enum class ColumnType {
+    INTEGER,
+    DOUBLE,
+    STRING,
+    COMPLEX,
+    FACTOR
+};
+
+// -------------------------------------------------------------------------------------------------
+
+template<typename T>
+class TypedColumn
+{
+public:
+    typedef T value_type;
+
+    TypedColumn(T const * const data_ptr, const std::size_t size)
+        : data_ptr_(data_ptr)
+        , size_(size)
+    { }
+
+    // no range checks, this is meant for hot loops
+    const T& operator[](const std::size_t id) const {
+        return data_ptr_[id];
+    }
+
+    T const * data() const {
+        return data_ptr_;
+    }
+
+    std::size_t size() const {
+        return size_;
+    }
+
+private:
+    T const * data_ptr_;
+    std::size_t size_;
+};
+
+// -------------------------------------------------------------------------------------------------
+// factor codes resolved to their levels' CHARSXPs on access, no character copy is ever made
+
+class FactorColumn
+{
+public:
+    typedef SEXP value_type;
+
+    FactorColumn(int const * const codes, SEXP const * const levels, const std::size_t num_levels, const std::size_t size)
+        : codes_(codes)
+        , levels_(levels)
+        , num_levels_(num_levels)
+        , size_(size)
+    { }
+
+    // no range checks, this is meant for hot loops
+    SEXP operator[](const std::size_t id) const {
+        return level(codes_[id]);
+    }
+
+    SEXP level(const int code) const {
+        return code == NA_INTEGER ? NA_STRING : levels_[code - 1];
+    }
+
+    int const * codes() const {
+        return codes_;
+    }
+
+    SEXP const * levels() const {
+        return levels_;
+    }
+
+    std::size_t num_levels() const {
+        return num_levels_;
+    }
+
+    std::size_t size() const {
+        return size_;
+    }
+
+private:
+    int const * codes_;
+    SEXP const * levels_;
+    std::size_t num_levels_;
+    std::size_t size_;
+};
+
+// -------------------------------------------------------------------------------------------------
+// a value per level computed once, so that hot loops only look codes up; NA codes map to NA_STRING's value
+
+class LevelTable
+{
+public:
+    LevelTable() = default;
+
+    template<typename F>
+    LevelTable(const FactorColumn& column, F level_value)
+        : values_(column.num_levels() + 1)
+    {
+        values_[0] = level_value(NA_STRING);
+        for (std::size_t k = 0; k < column.num_levels(); k++) {
+            values_[k + 1] = level_value(column.levels()[k]);
+        }
+    }
+
+    unsigned char operator[](const int code) const {
+        return values_[code == NA_INTEGER ? 0 : code];
+    }
+
+private:
+    std::vector<unsigned char> values_;
+};
+
+// -------------------------------------------------------------------------------------------------
+// what the SIMD kernels can read directly, null if cells are not stored as such
+
+template<typename T>
+T const * contiguous_cells(const TypedColumn<T>& column, const std::size_t begin) {
+    return column.data() + begin;
+}
+
+inline SEXP const * contiguous_cells(const FactorColumn&, const std::size_t) {
+    return nullptr;
+}
+
+// -------------------------------------------------------------------------------------------------
+// type-erased TypedColumn that collections fill once per column,
+// so that workers can switch on the type once instead of constructing a variant per cell
+
+class ColumnSpan
+{
+public:
+    ColumnSpan(int const * const data_ptr, const std::size_t size, const bool is_logical = false)
+        : ColumnSpan(ColumnType::INTEGER, data_ptr, size, is_logical)
+    { }
+
+    ColumnSpan(double const * const data_ptr, const std::size_t size)
+        : ColumnSpan(ColumnType::DOUBLE, data_ptr, size, false)
+    { }
+
+    ColumnSpan(SEXP const * const data_ptr, const std::size_t size)
+        : ColumnSpan(ColumnType::STRING, data_ptr, size, false)
+    { }
+
+    ColumnSpan(std::complex<double> const * const data_ptr, const std::size_t size)
+        : ColumnSpan(ColumnType::COMPLEX, data_ptr, size, false)
+    { }
+
+    ColumnSpan(int const * const codes, SEXP const * const levels, const std::size_t num_levels, const std::size_t size)
+        : ColumnSpan(ColumnType::FACTOR, codes, size, false)
+    {
+        levels_ = levels;
+        num_levels_ = num_levels;
+    }
+
+    ColumnType type() const {
+        return type_;
+    }
+
+    bool is_logical() const {
+        return is_logical_;
+    }
+
+    std::size_t size() const {
+        return size_;
+    }
+
+    // caller must have checked type()
+    template<typename T>
+    TypedColumn<T> as() const {
+        return TypedColumn<T>(static_cast<T const *>(data_ptr_), size_);
+    }
+
+    // caller must have checked type()
+    FactorColumn as_factor() const {
+        return FactorColumn(static_cast<int const *>(data_ptr_), levels_, num_levels_, size_);
+    }
+
+    // hint that cell i will be read soon, only its slot, not what a string points to
+    void prefetch(const std::size_t i) const {
+        __builtin_prefetch(static_cast<const char *>(data_ptr_) + i * cell_size());
+    }
+
+private:
+    std::size_t cell_size() const {
+        switch(type_) {
+        case ColumnType::DOUBLE:
+            return sizeof(double);
+        case ColumnType::STRING:
+            return sizeof(SEXP);
+        case ColumnType::COMPLEX:
+            return sizeof(std::complex<double>);
+        default:
+            return sizeof(int);
+        }
+    }
+
+    ColumnSpan(const ColumnType type, void const * const data_ptr, const std::size_t size, const bool is_logical)
+        : type_(type)
+        , data_ptr_(data_ptr)
+        , size_(size)
+        , is_logical_(is_logical)
+    { }
+
+    ColumnType type_;
+    void const * data_ptr_;
+    SEXP const * levels_ = nullptr;
+    std::size_t num_levels_ = 0;
+    std::size_t size_;
+    bool is_logical_;
+};
+
+// -------------------------------------------------------------------------------------------------
+// what visitors receive for each kind of cell read through a TypedColumn
+
+inline int visitable(const int val) {
+    return val;
+}
+
+inline double visitable(const double val) {
+    return val;
+}
+
+inline boost::string_ref visitable(const SEXP val) {
+    return boost::string_ref(CHAR(val));
+}
+
+inline const std::complex<double>& visitable(const std::complex<double>& val) {
+    return val;
+}
+
 // =================================================================================================
 
 class VariantColumn
@@ -22,6 +257,7 @@ class VariantColumn
 public:
     virtual ~VariantColumn() {}
     virtual const supported_col_t operator[](const std::size_t id) const = 0;
+    virtual ColumnSpan span() const = 0;
 
     // sometimes we need to know
     virtual bool is_logical() const {
@@ -44,10 +280,45 @@ public:
     std::shared_ptr<const VariantColumn> operator[](const std::size_t j) const;
     const supported_col_t operator()(const std::size_t i, const std::size_t j) const;
 
+    const ColumnSpan& span(const std::size_t j) const {
+        return spans_[j];
+    }
+
+    void prefetch_row(const std::size_t i) const {
+        for (const ColumnSpan& span : spans_) span.prefetch(i);
+    }
+
+    // like boost::apply_visitor(visitor, (*this)(i, j)) but without the virtual call and the variant
+    template<typename Visitor>
+    typename Visitor::result_type visit(const std::size_t i, const std::size_t j, Visitor& visitor) const {
+        const ColumnSpan& span = spans_[j];
+
+        switch(span.type()) {
+        case ColumnType::INTEGER: {
+            return visitor(span.as<int>()[i]);
+        }
+        case ColumnType::DOUBLE: {
+            return visitor(span.as<double>()[i]);
+        }
+        case ColumnType::STRING: {
+            return visitor(visitable(span.as<SEXP>()[i]));
+        }
+        case ColumnType::FACTOR: {
+            return visitor(visitable(span.as_factor()[i]));
+        }
+        default: {
+            return visitor(span.as<std::complex<double>>()[i]);
+        }
+        }
+    }
+
 protected:
     ColumnCollection(const std::size_t nrow);
 
+    void push_back(const std::shared_ptr<const VariantColumn>& column);
+
     std::vector<std::shared_ptr<const VariantColumn>> columns_;
+    std::vector<ColumnSpan> spans_;
     const std::size_t nrow_;
 };
 
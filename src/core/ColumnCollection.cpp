@@ -46,6 +46,11 @@ ColumnCollection::ColumnCollection(const std::size_t nrow)
     : nrow_(nrow)
 { }
 
+void ColumnCollection::push_back(const std::shared_ptr<const VariantColumn>& column) {
+    columns_.push_back(column);
+    spans_.push_back(column->span());
+}
+
 std::size_t ColumnCollection::ncol() const {
     return columns_.size();
 }
@@ -23,43 +23,32 @@ DataFrameColumnCollection::DataFrameColumnCollection(const Rcpp::DataFrame& df,
             Rcpp::IntegerVector vec(df[current_j]);
 
             if (!Rf_isFactor(df[current_j]) || metadata.factor_mode == INTSXP) {
-                columns_.push_back(std::make_shared<SurrogateColumn<int>>(&vec[0], vec.length()));
+                push_back(std::make_shared<SurrogateColumn<int>>(&vec[0], vec.length()));
             }
             else {
-                Rcpp::StringVector levels = vec.attr("levels");
-                Rcpp::StringVector factors(vec.length());
-                for (R_xlen_t i = 0; i < vec.length(); i++) {
-                    if (Rcpp::IntegerVector::is_na(vec[i])) {
-                        factors[i] = NA_STRING;
-                    }
-                    else {
-                        factors[i] = levels[vec[i] - 1];
-                    }
-                }
-
-                columns_.push_back(std::make_shared<SurrogateColumn<Rcpp::StringVector>>(factors));
+                push_back(std::make_shared<SurrogateColumn<FactorColumn>>(vec));
             }
 
             break;
         }
         case REALSXP: {
             Rcpp::NumericVector vec(df[current_j]);
-            columns_.push_back(std::make_shared<SurrogateColumn<double>>(&vec[0], vec.length()));
+            push_back(std::make_shared<SurrogateColumn<double>>(&vec[0], vec.length()));
             break;
         }
         case LGLSXP: {
             Rcpp::LogicalVector vec(df[current_j]);
-            columns_.push_back(std::make_shared<SurrogateColumn<int>>(&vec[0], vec.length(), true));
+            push_back(std::make_shared<SurrogateColumn<int>>(&vec[0], vec.length(), true));
             break;
         }
         case STRSXP: {
             Rcpp::StringVector vec(df[current_j]);
-            columns_.push_back(std::make_shared<SurrogateColumn<Rcpp::StringVector>>(vec));
+            push_back(std::make_shared<SurrogateColumn<Rcpp::StringVector>>(vec));
             break;
         }
         case CPLXSXP: {
             Rcpp::ComplexVector vec(df[current_j]);
-            columns_.push_back(std::make_shared<SurrogateColumn<Rcpp::ComplexVector>>(vec));
+            push_back(std::make_shared<SurrogateColumn<Rcpp::ComplexVector>>(vec));
             break;
         }
         default: { // nocov start
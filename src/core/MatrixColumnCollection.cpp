@@ -9,12 +9,12 @@ MatrixColumnCollection<STRSXP, const char *>::MatrixColumnCollection(const Rcpp:
     if (cols.ptr) {
         for (std::size_t i = 0; i < cols.len; i++) {
             int j = cols.ptr[i] - 1;
-            columns_.push_back(std::make_shared<SurrogateColumn<Rcpp::StringMatrix>>(mat, j));
+            push_back(std::make_shared<SurrogateColumn<Rcpp::StringMatrix>>(mat, j));
         }
     }
     else if (cols.is_null) {
         for (int j = 0; j < mat.ncol(); j++) {
-            columns_.push_back(std::make_shared<SurrogateColumn<Rcpp::StringMatrix>>(mat, j));
+            push_back(std::make_shared<SurrogateColumn<Rcpp::StringMatrix>>(mat, j));
         }
     }
 }
@@ -28,12 +28,12 @@ MatrixColumnCollection<CPLXSXP, std::complex<double>>::MatrixColumnCollection(co
     if (cols.ptr) {
         for (std::size_t i = 0; i < cols.len; i++) {
             int j = cols.ptr[i] - 1;
-            columns_.push_back(std::make_shared<SurrogateColumn<Rcpp::ComplexMatrix>>(mat, j));
+            push_back(std::make_shared<SurrogateColumn<Rcpp::ComplexMatrix>>(mat, j));
         }
     }
     else if (cols.is_null) {
         for (int j = 0; j < mat.ncol(); j++) {
-            columns_.push_back(std::make_shared<SurrogateColumn<Rcpp::ComplexMatrix>>(mat, j));
+            push_back(std::make_shared<SurrogateColumn<Rcpp::ComplexMatrix>>(mat, j));
         }
     }
 }
@@ -23,12 +23,12 @@ public:
         if (cols.ptr) {
             for (std::size_t i = 0; i < cols.len; i++) {
                 int j = cols.ptr[i] - 1;
-                columns_.push_back(std::make_shared<SurrogateColumn<T>>(&mat[j * nrow_], nrow_, is_logical));
+                push_back(std::make_shared<SurrogateColumn<T>>(&mat[j * nrow_], nrow_, is_logical));
             }
         }
         else if (cols.is_null) {
             for (int j = 0; j < mat.ncol(); j++) {
-                columns_.push_back(std::make_shared<SurrogateColumn<T>>(&mat[j * nrow_], nrow_, is_logical));
+                push_back(std::make_shared<SurrogateColumn<T>>(&mat[j * nrow_], nrow_, is_logical));
             }
         }
     }
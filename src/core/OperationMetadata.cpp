@@ -117,6 +117,7 @@ surrogate_vector coerce_subset_indices(SEXP ids) {
 
 OperationMetadata::OperationMetadata(const Rcpp::List& metadata)
     : num_workers(Rcpp::as<int>(metadata["num_workers"]))
+    , grain_size(static_cast<std::size_t>(Rcpp::as<int>(metadata["grain_size"])))
     , input_class(parse_input_class(metadata))
     , input_modes(parse_modes(metadata["input_modes"]))
     , output_class(parse_output_class(metadata))
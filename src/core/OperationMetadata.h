@@ -37,6 +37,7 @@ public:
     OperationMetadata(const Rcpp::List& metadata);
 
     const int num_workers;
+    const std::size_t grain_size; // 0 means automatic
 
     const RClass input_class;
     const std::vector<R_vec_t> input_modes;
@@ -2,6 +2,10 @@
  * The constructors here take by value because we're mostly dealing with wrappers, so copies are
  * cheap, and it makes it easier to instantiate shared_ptr<OutputWrapper<T>> by passing a SEXP
  * variant to the constructors.
+ *
+ * Besides the virtual, range-checked interface, each concrete wrapper is a static output sink:
+ * workers that take the concrete type as template parameter call validate() once and then use the
+ * non-virtual at() and fill_block(), which compile to plain pointer stores.
  */
 
 #ifndef WISEROW_OUTPUTWRAPPER_H_
@@ -31,60 +35,66 @@ public:
     virtual T& operator()(const std::size_t i, const std::size_t j) = 0;
 };
 
+// -------------------------------------------------------------------------------------------------
+// Rcomplex and std::complex<double> have the same layout
+
+template<typename T, int RT>
+T *output_ptr(Rcpp::Vector<RT>& vec) {
+    return reinterpret_cast<T *>(&vec[0]);
+}
+
 // =================================================================================================
 
 template<R_vec_t RT, typename T>
-class VectorOutputWrapper : public OutputWrapper<T> {
+class VectorOutputWrapper final : public OutputWrapper<T> {
 public:
     VectorOutputWrapper(Rcpp::Vector<RT> data)
-        : data_(&data[0])
+        : data_(output_ptr<T>(data))
         , len_(data.length())
     { }
 
     virtual T& operator()(const std::size_t i, const std::size_t j) override {
+        validate(i + 1, j + 1);
+        return at(i, j);
+    }
+
+    void validate(const std::size_t nrow, const std::size_t ncol) const {
         // nocov start
-        if (j > 0) {
+        if (ncol > 1) {
             throw std::out_of_range("[wiserow] attempted to index a vector of length " +
                                     std::to_string(len_) +
                                     " as matrix at column " +
-                                    std::to_string(j));
+                                    std::to_string(ncol - 1));
         }
 
-        if (i >= len_) {
+        if (nrow > len_) {
             throw std::out_of_range("[wiserow] attempted to index a vector of length " +
                                     std::to_string(len_) +
                                     " at " +
-                                    std::to_string(i + 1));
+                                    std::to_string(nrow));
         }
         // nocov end
+    }
 
+    T& at(const std::size_t i, const std::size_t) {
         return data_[i];
     }
 
-private:
-    T * const data_;
-    const std::size_t len_;
-};
-
-// -------------------------------------------------------------------------------------------------
-// Specialization for CPLXSXP, std::complex<double>
-
-template<>
-class VectorOutputWrapper<CPLXSXP, std::complex<double>> : public OutputWrapper<std::complex<double>> {
-public:
-    VectorOutputWrapper(Rcpp::ComplexVector vec);
-
-    virtual std::complex<double>& operator()(const std::size_t i, const std::size_t j) override;
+    template<typename F>
+    void fill_block(const std::size_t i, const std::size_t, const std::size_t n, F value) {
+        T *out = data_ + i;
+        for (std::size_t r = 0; r < n; r++) out[r] = value(r);
+    }
 
 private:
-    std::complex<double> * const data_;
+    T * const data_;
     const std::size_t len_;
 };
 
 // =================================================================================================
 
 template<R_vec_t RT, typename T>
-class ListOutputWrapper : public OutputWrapper<T> {
+class ListOutputWrapper final : public OutputWrapper<T> {
 public:
     ListOutputWrapper(Rcpp::List data)
         : data_(data.length())
@@ -94,7 +104,7 @@ public:
             Rcpp::Vector<RT> one_vec(data[i]);
             lens_[i] = one_vec.length();
             if (one_vec.length() > 0) {
-                data_[i] = &one_vec[0];
+                data_[i] = output_ptr<T>(one_vec);
             }
         }
     }
@@ -116,33 +126,48 @@ public:
         }
         // nocov end
 
-        return data_[i][j];
+        return at(i, j);
     }
 
-private:
-    std::vector<T *> data_;
-    std::vector<std::size_t> lens_;
-};
+    void validate(const std::size_t nrow, const std::size_t ncol) const {
+        // nocov start
+        if (nrow > data_.size()) {
+            throw std::out_of_range("[wiserow] attempted to index a list of length " +
+                                    std::to_string(data_.size()) +
+                                    " at " +
+                                    std::to_string(nrow));
+        }
 
-// -------------------------------------------------------------------------------------------------
-// Specialization for CPLXSXP, std::complex<double>
+        for (std::size_t i = 0; i < nrow; i++) {
+            if (ncol > lens_[i]) {
+                throw std::out_of_range("[wiserow] attempted to index an enlisted vector of length " +
+                                        std::to_string(lens_[i]) +
+                                        " at " +
+                                        std::to_string(ncol));
+            }
+        }
+        // nocov end
+    }
 
-template<>
-class ListOutputWrapper<CPLXSXP, std::complex<double>> : public OutputWrapper<std::complex<double>> {
-public:
-    ListOutputWrapper(Rcpp::List data);
+    T& at(const std::size_t i, const std::size_t j) {
+        return data_[i][j];
+    }
 
-    virtual std::complex<double>& operator()(const std::size_t i, const std::size_t j) override;
+    // rows are separate vectors here
+    template<typename F>
+    void fill_block(const std::size_t i, const std::size_t j, const std::size_t n, F value) {
+        for (std::size_t r = 0; r < n; r++) data_[i + r][j] = value(r);
+    }
 
 private:
-    std::vector<std::complex<double> *> data_;
+    std::vector<T *> data_;
     std::vector<std::size_t> lens_;
 };
 
 // =================================================================================================
 
 template<R_vec_t RT, typename T>
-class DataFrameOutputWrapper : public OutputWrapper<T> {
+class DataFrameOutputWrapper final : public OutputWrapper<T> {
 public:
     DataFrameOutputWrapper(Rcpp::DataFrame data)
         : cols_(data.ncol())
@@ -152,7 +177,7 @@ public:
             Rcpp::Vector<RT> one_vec(data[j]);
             lens_[j] = one_vec.length();
             if (one_vec.length() > 0) {
-                cols_[j] = &one_vec[0];
+                cols_[j] = output_ptr<T>(one_vec);
             }
         }
     }
@@ -174,38 +199,53 @@ public:
         }
         // nocov end
 
-        return cols_[j][i];
+        return at(i, j);
     }
 
-private:
-    std::vector<T *> cols_;
-    std::vector<std::size_t> lens_;
-};
+    void validate(const std::size_t nrow, const std::size_t ncol) const {
+        // nocov start
+        if (ncol > cols_.size()) {
+            throw std::out_of_range("[wiserow] attempted to index data frame with " +
+                                    std::to_string(cols_.size()) +
+                                    " columns at column " +
+                                    std::to_string(ncol));
+        }
 
-// -------------------------------------------------------------------------------------------------
-// Specialization for CPLXSXP, std::complex<double>
+        for (std::size_t j = 0; j < ncol; j++) {
+            if (nrow > lens_[j]) {
+                throw std::out_of_range("[wiserow] attempted to index a data frame with " +
+                                        std::to_string(lens_[j]) +
+                                        " rows at row " +
+                                        std::to_string(nrow));
+            }
+        }
+        // nocov end
+    }
 
-template<>
-class DataFrameOutputWrapper<CPLXSXP, std::complex<double>> : public OutputWrapper<std::complex<double>> {
-public:
-    DataFrameOutputWrapper(Rcpp::DataFrame data);
+    T& at(const std::size_t i, const std::size_t j) {
+        return cols_[j][i];
+    }
 
-    virtual std::complex<double>& operator()(const std::size_t i, const std::size_t j) override;
+    template<typename F>
+    void fill_block(const std::size_t i, const std::size_t j, const std::size_t n, F value) {
+        T *out = cols_[j] + i;
+        for (std::size_t r = 0; r < n; r++) out[r] = value(r);
+    }
 
 private:
-    std::vector<std::complex<double> *> cols_;
+    std::vector<T *> cols_;
     std::vector<std::size_t> lens_;
 };
 
 // =================================================================================================
 
 template<int RT, typename T>
-class MatrixOutputWrapper : public OutputWrapper<T> {
+class MatrixOutputWrapper final : public OutputWrapper<T> {
 public:
     MatrixOutputWrapper(Rcpp::Matrix<RT> data)
         : ncol_(data.ncol())
         , nrow_(data.nrow())
-        , data_(&data[0])
+        , data_(output_ptr<T>(data))
     {
         // nocov start
         if (ncol_ == 0 || nrow_ == 0) {
@@ -215,45 +255,42 @@ public:
     }
 
     virtual T& operator()(const std::size_t i, const std::size_t j) override {
+        validate(i + 1, j + 1);
+        return at(i, j);
+    }
+
+    void validate(const std::size_t nrow, const std::size_t ncol) const {
         // nocov start
-        if (j >= ncol_) {
+        if (ncol > ncol_) {
             throw std::out_of_range("[wiserow] attempted to index matrix with " +
                                     std::to_string(ncol_) +
                                     " columns at column " +
-                                    std::to_string(j + 1));
+                                    std::to_string(ncol));
         }
 
-        if (i >= nrow_) {
+        if (nrow > nrow_) {
             throw std::out_of_range("[wiserow] attempted to index a matrix with " +
                                     std::to_string(nrow_) +
                                     " rows at row " +
-                                    std::to_string(i + 1));
+                                    std::to_string(nrow));
         }
         // nocov end
+    }
 
+    T& at(const std::size_t i, const std::size_t j) {
         return data_[i + j * nrow_];
     }
 
-private:
-    const std::size_t ncol_;
-    const std::size_t nrow_;
-    T * const data_;
-};
-
-// -------------------------------------------------------------------------------------------------
-// Specialization for CPLXSXP, std::complex<double>
-
-template<>
-class MatrixOutputWrapper<CPLXSXP, std::complex<double>> : public OutputWrapper<std::complex<double>> {
-public:
-    MatrixOutputWrapper(Rcpp::Matrix<CPLXSXP> data);
-
-    virtual std::complex<double>& operator()(const std::size_t i, const std::size_t j) override;
+    template<typename F>
+    void fill_block(const std::size_t i, const std::size_t j, const std::size_t n, F value) {
+        T *out = data_ + i + j * nrow_;
+        for (std::size_t r = 0; r < n; r++) out[r] = value(r);
+    }
 
 private:
     const std::size_t ncol_;
     const std::size_t nrow_;
-    std::complex<double> * const data_;
+    T * const data_;
 };
 
 } // namespace wiserow
@@ -1,12 +1,44 @@
 #include "ParallelWorker.h"
 
+#include <algorithm> // max, min, sort
+#include <stdexcept> // logic_error
+#include <utility> // pair
+
 namespace wiserow {
 
+const std::size_t ParallelWorker::BLOCK_SIZE = 2048;
+const std::size_t ParallelWorker::BLOCK_MIN_COLS = 8;
+
+const std::size_t ParallelWorker::TILE_BYTES = 256 * 1024;
+const std::size_t ParallelWorker::TILE_MAX_ROWS = 256;
+
+const std::size_t ParallelWorker::COLUMN_SLAB = 2048;
+const std::size_t ParallelWorker::WIDE_RATIO = 8;
+const std::size_t ParallelWorker::MAX_SLABS = 64;
+
+const std::size_t ChunkedWorker::ROWS;
+
+// a task should cost at least this many plain numeric cells, so that scheduling it is ~1% of its runtime
+static const double TASK_MIN_COST = 100000;
+// above that, there should be this many tasks per thread, so that threads that finish early can take some more
+static const std::size_t TASKS_PER_WORKER = 8;
+
+// cost between checks for interrupts or failures in other threads, a few ms
+static const double CHECK_COST = 1000000;
+
+// smaller unsorted subsets are not worth sorting
+static const std::size_t SORT_MIN_ROWS = 4096;
+// how many rows ahead to prefetch when rows are not contiguous
+static const std::size_t PREFETCH_ROWS = 8;
+
+// -------------------------------------------------------------------------------------------------
+
 ParallelWorker::ParallelWorker(const OperationMetadata& metadata, const ColumnCollection& cc)
     : metadata(metadata)
     , col_collection_(cc)
-    , interrupt_grain_(interrupt_grain(this->num_ops() / metadata.num_workers, 1000, 10000))
-{ }
+{
+    classify_rows();
+}
 
 std::size_t ParallelWorker::num_ops() const {
     if (metadata.rows.ptr) {
@@ -20,46 +52,403 @@ std::size_t ParallelWorker::num_ops() const {
     }
 }
 
+/*
+ * The grain can be fixed with options(wiserow.grain_size) or the WISEROW_GRAIN_SIZE environment variable,
+ * see op_ctrl. Either way it is rounded up to whole chunks.
+ */
+std::size_t ParallelWorker::grain_size() const {
+    return grain_size(num_ops(), row_cost(), metadata.num_workers, metadata.grain_size);
+}
+
+// the balance bound only makes tasks smaller while each of them still costs at least TASK_MIN_COST,
+// so cheap data never ends up with more than num_workers * TASKS_PER_WORKER tasks
+std::size_t ParallelWorker::grain_size(const std::size_t num_ops,
+                                       const double row_cost,
+                                       const int num_workers,
+                                       const std::size_t fixed_grain)
+{
+    std::size_t grain = fixed_grain;
+
+    if (grain == 0) {
+        std::size_t by_cost = static_cast<std::size_t>(TASK_MIN_COST / row_cost);
+        std::size_t by_balance = num_ops / (static_cast<std::size_t>(std::max(num_workers, 1)) * TASKS_PER_WORKER);
+        grain = std::max(by_cost, by_balance);
+    }
+
+    std::size_t chunks = (grain + ChunkedWorker::ROWS - 1) / ChunkedWorker::ROWS;
+    return std::max(chunks, std::size_t(1)) * ChunkedWorker::ROWS;
+}
+
+// -------------------------------------------------------------------------------------------------
+
 void ParallelWorker::operator()(std::size_t begin, std::size_t end) {
-    if (threw) return;
+    guarded([&](WorkerScratch& scratch) {
+        std::size_t ncol = col_collection_.ncol();
 
-    try {
-        thread_local_ptr t_local(nullptr);
+        if (supports_blocks() && ncol > 0 && (ncol >= BLOCK_MIN_COLS || narrow_blocks())) {
+            // wide blocks are shortened so that they poll as often as rows do
+            std::size_t block_rows = std::min(BLOCK_SIZE, check_rows_);
+
+            for (std::size_t block_begin = begin; block_begin < end; block_begin += block_rows) {
+                if (block_begin > begin && should_stop()) break;
+
+                std::size_t block_end = std::min(block_begin + block_rows, end);
+                work_block(make_block(block_begin, block_end, scratch), scratch);
+            }
+        }
+        else if (supports_tiles() && ncol >= BLOCK_MIN_COLS) {
+            std::size_t tile_rows = std::min(std::max(TILE_BYTES / (ncol * sizeof(TileCell)), std::size_t(1)), TILE_MAX_ROWS);
+            tile_rows = std::min(tile_rows, check_rows_);
+            scratch_vector<TileCell> tile(std::min(tile_rows, end - begin) * ncol, TileCell(), scratch.arena);
+
+            for (std::size_t tile_begin = begin; tile_begin < end; tile_begin += tile_rows) {
+                if (tile_begin > begin && should_stop()) break;
+
+                RowBlock block = make_block(tile_begin, std::min(tile_begin + tile_rows, end), scratch);
+                fill_tile(block, tile.data());
 
-        for (std::size_t id = begin; id < end; id++) {
-            if (threw || is_interrupted(id)) break;
+                for (std::size_t r = 0; r < block.size; r++) {
+                    work_tile_row(TileRow(&tile[r * ncol]), block.out_id(r), scratch);
+                }
+            }
+        }
+        else {
+            for (std::size_t sub_begin = begin; sub_begin < end; sub_begin += check_rows_) {
+                if (sub_begin > begin && should_stop()) break;
+                std::size_t sub_end = std::min(sub_begin + check_rows_, end);
 
-            t_local = work_row(corresponding_row(id), id, t_local);
+                if (dense_rows_) {
+                    for (std::size_t id = sub_begin; id < sub_end; id++) {
+                        work_row(first_row_ + id, id, scratch);
+                    }
+                }
+                else {
+                    for (std::size_t id = sub_begin; id < sub_end; id++) {
+                        if (id + PREFETCH_ROWS < end) col_collection_.prefetch_row(in_row(id + PREFETCH_ROWS));
+                        work_row(in_row(id), out_row(id), scratch);
+                    }
+                }
+            }
         }
+    });
+}
+
+// runs f with a scratch unless some thread failed or the user interrupted, f's exceptions are kept for parallel_for
+template<typename F>
+void ParallelWorker::guarded(F f) {
+    if (should_stop()) return;
+
+    WorkerScratch *scratch = nullptr;
+
+    try {
+        scratch = &acquire_scratch();
+        f(*scratch);
     }
     catch (...) {
         mutex_.lock();
         if (!threw) {
             eptr = std::current_exception();
-            threw = true;
+            threw.store(true, std::memory_order_relaxed);
         }
         mutex_.unlock();
     }
 
+    if (scratch) release_scratch(*scratch);
+
     // make sure this is called at least once per thread call
     RcppThread::isInterrupted();
 }
 
-std::size_t ParallelWorker::corresponding_row(std::size_t id) const {
-    return metadata.rows.ptr ? metadata.rows.ptr[id] - 1 : id;
+RowBlock ParallelWorker::make_block(const std::size_t block_begin,
+                                    const std::size_t block_end,
+                                    WorkerScratch& scratch) const
+{
+    std::size_t size = block_end - block_begin;
+    RowBlock block { block_begin, size, nullptr, dense_rows_, nullptr };
+
+    if (!sorted_in_rows_.empty()) {
+        block.in_ids = &sorted_in_rows_[block_begin];
+        block.out_ids = &sorted_out_rows_[block_begin];
+    }
+    else {
+        std::vector<std::size_t>& in_ids = scratch.row_ids;
+        if (in_ids.size() < size) in_ids.resize(std::max(size, std::min(BLOCK_SIZE, num_ops())));
+
+        for (std::size_t r = 0; r < size; r++) {
+            in_ids[r] = in_row(block_begin + r);
+        }
+
+        block.in_ids = in_ids.data();
+    }
+
+    if (!dense_rows_) {
+        block.contiguous = true;
+        for (std::size_t r = 1; block.contiguous && r < size; r++) {
+            block.contiguous = block.in_ids[r] == block.in_ids[0] + r;
+        }
+    }
+
+    return block;
+}
+
+// the tile is read row by row afterwards, so it should fit in the cache while it's written column by column
+void ParallelWorker::fill_tile(const RowBlock& block, TileCell *tile) const {
+    std::size_t ncol = col_collection_.ncol();
+    const std::size_t *in_ids = block.in_ids;
+
+    for (std::size_t j = 0; j < ncol; j++) {
+        const ColumnSpan& span = col_collection_.span(j);
+        TileCell *cell = tile + j;
+
+        switch(span.type()) {
+        case ColumnType::INTEGER: {
+            TypedColumn<int> column = span.as<int>();
+            for (std::size_t r = 0; r < block.size; r++, cell += ncol) cell->integer = column[in_ids[r]];
+            break;
+        }
+        case ColumnType::DOUBLE: {
+            TypedColumn<double> column = span.as<double>();
+            for (std::size_t r = 0; r < block.size; r++, cell += ncol) cell->real = column[in_ids[r]];
+            break;
+        }
+        case ColumnType::STRING: {
+            TypedColumn<SEXP> column = span.as<SEXP>();
+            for (std::size_t r = 0; r < block.size; r++, cell += ncol) cell->string = column[in_ids[r]];
+            break;
+        }
+        case ColumnType::COMPLEX: {
+            TypedColumn<std::complex<double>> column = span.as<std::complex<double>>();
+            for (std::size_t r = 0; r < block.size; r++, cell += ncol) {
+                const std::complex<double>& val = column[in_ids[r]];
+                cell->complex[0] = val.real();
+                cell->complex[1] = val.imag();
+            }
+            break;
+        }
+        case ColumnType::FACTOR: {
+            int const *codes = span.as_factor().codes();
+            for (std::size_t r = 0; r < block.size; r++, cell += ncol) cell->integer = codes[in_ids[r]];
+            break;
+        }
+        }
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+
+namespace {
+
+// parallelFor over the tasks of one of ParallelWorker's member functions
+class TaskWorker : public RcppParallel::Worker
+{
+public:
+    typedef void (ParallelWorker::*Tasks)(std::size_t, std::size_t);
+
+    TaskWorker(ParallelWorker& worker, Tasks tasks)
+        : worker_(worker)
+        , tasks_(tasks)
+    { }
+
+    void operator()(std::size_t begin, std::size_t end) override {
+        (worker_.*tasks_)(begin, end);
+    }
+
+private:
+    ParallelWorker& worker_;
+    Tasks tasks_;
+};
+
+} // anonymous namespace
+
+bool ParallelWorker::use_column_split() const {
+    std::size_t ncol = col_collection_.ncol();
+    return supports_blocks() && supports_column_split() && ncol >= 2 * COLUMN_SLAB && ncol >= WIDE_RATIO * num_ops();
 }
 
-bool ParallelWorker::is_interrupted(const std::size_t i) const {
-    return RcppThread::isInterrupted(i % interrupt_grain_ == 0);
+void ParallelWorker::run_column_split() {
+    std::size_t ncol = col_collection_.ncol();
+    std::size_t num_blocks = (num_ops() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+
+    slab_width_ = std::max(COLUMN_SLAB, (ncol + MAX_SLABS - 1) / MAX_SLABS);
+    num_slabs_ = (ncol + slab_width_ - 1) / slab_width_;
+    partials_.assign(num_blocks * num_slabs_, nullptr);
+
+    TaskWorker scan_worker(*this, &ParallelWorker::scan_slab_tasks);
+    RcppParallel::parallelFor(0, partials_.size(), scan_worker, 1);
+    if (threw) return;
+
+    TaskWorker merge_worker(*this, &ParallelWorker::merge_slab_tasks);
+    RcppParallel::parallelFor(0, num_blocks, merge_worker, 1);
+}
+
+// cell_cost is virtual, so check_rows_ can only be computed once the derived worker is constructed
+void ParallelWorker::run_row_chunks() {
+    check_rows_ = check_rows();
+
+    ChunkedWorker chunked_worker(*this, num_ops());
+    RcppParallel::parallelFor(0, chunked_worker.num_chunks(), chunked_worker, grain_size() / ChunkedWorker::ROWS);
+}
+
+void ParallelWorker::scan_slab_tasks(std::size_t begin, std::size_t end) {
+    guarded([&](WorkerScratch& scratch) {
+        for (std::size_t task = begin; task < end; task++) {
+            if (task > begin && should_stop()) break;
+
+            std::size_t block_begin = (task / num_slabs_) * BLOCK_SIZE;
+            std::size_t j_begin = (task % num_slabs_) * slab_width_;
+            RowBlock block = make_block(block_begin, std::min(block_begin + BLOCK_SIZE, num_ops()), scratch);
+
+            partials_[task] = scan_slab(block, j_begin, std::min(j_begin + slab_width_, col_collection_.ncol()), scratch.arena);
+        }
+    });
+}
+
+void ParallelWorker::merge_slab_tasks(std::size_t begin, std::size_t end) {
+    guarded([&](WorkerScratch& scratch) {
+        for (std::size_t b = begin; b < end; b++) {
+            if (b > begin && should_stop()) break;
+
+            std::size_t block_begin = b * BLOCK_SIZE;
+            RowBlock block = make_block(block_begin, std::min(block_begin + BLOCK_SIZE, num_ops()), scratch);
+
+            merge_slabs(block, &partials_[b * num_slabs_], num_slabs_, scratch);
+        }
+    });
+}
+
+// -------------------------------------------------------------------------------------------------
+
+WorkerScratch& ParallelWorker::acquire_scratch() {
+    scratch_mutex_.lock();
+
+    if (free_scratches_.empty()) {
+        scratches_.emplace_back(new WorkerScratch);
+        free_scratches_.push_back(scratches_.back().get());
+    }
+
+    WorkerScratch *scratch = free_scratches_.back();
+    free_scratches_.pop_back();
+
+    scratch_mutex_.unlock();
+    return *scratch;
+}
+
+void ParallelWorker::release_scratch(WorkerScratch& scratch) {
+    scratch_mutex_.lock();
+    free_scratches_.push_back(&scratch);
+    scratch_mutex_.unlock();
+}
+
+void ParallelWorker::classify_rows() {
+    dense_rows_ = !metadata.rows.ptr;
+    first_row_ = 0;
+
+    std::size_t n = metadata.rows.len;
+    if (dense_rows_ || n == 0) return;
+
+    const int *rows = metadata.rows.ptr;
+    bool contiguous = true, sorted = true;
+    for (std::size_t id = 1; sorted && id < n; id++) {
+        contiguous = contiguous && rows[id] == rows[id - 1] + 1;
+        sorted = rows[id] >= rows[id - 1];
+    }
+
+    if (contiguous) {
+        dense_rows_ = true;
+        first_row_ = rows[0] - 1;
+        return;
+    }
+
+    if (sorted || n < SORT_MIN_ROWS) return;
+
+    // stable, so repeated rows keep their output order
+    sorted_in_rows_.resize(n);
+    sorted_out_rows_.resize(n);
+    std::size_t nrow = col_collection_.nrow();
+
+    if (n >= nrow / 8) {
+        // counting sort, starts[i] is where input row i goes (indices were checked in R)
+        std::vector<std::size_t> starts(nrow + 1, 0);
+        for (std::size_t id = 0; id < n; id++) starts[rows[id]]++;
+        for (std::size_t i = 1; i <= nrow; i++) starts[i] += starts[i - 1];
+
+        for (std::size_t id = 0; id < n; id++) {
+            std::size_t pos = starts[rows[id] - 1]++;
+            sorted_in_rows_[pos] = rows[id] - 1;
+            sorted_out_rows_[pos] = id;
+        }
+    }
+    else {
+        std::vector<std::pair<int, std::size_t>> pairs(n);
+        for (std::size_t id = 0; id < n; id++) pairs[id] = std::make_pair(rows[id], id);
+        std::sort(pairs.begin(), pairs.end());
+
+        for (std::size_t pos = 0; pos < n; pos++) {
+            sorted_in_rows_[pos] = pairs[pos].first - 1;
+            sorted_out_rows_[pos] = pairs[pos].second;
+        }
+    }
+}
+
+std::size_t ParallelWorker::in_row(const std::size_t id) const {
+    if (dense_rows_) return first_row_ + id;
+    if (!sorted_in_rows_.empty()) return sorted_in_rows_[id];
+    return metadata.rows.ptr[id] - 1;
+}
+
+std::size_t ParallelWorker::out_row(const std::size_t id) const {
+    return sorted_out_rows_.empty() ? id : sorted_out_rows_[id];
+}
+
+bool ParallelWorker::should_stop() const {
+    return threw.load(std::memory_order_relaxed) || RcppThread::isInterrupted();
+}
+
+// nocov start
+void ParallelWorker::work_block(const RowBlock&, WorkerScratch&) {
+    throw std::logic_error("[wiserow] This worker does not support column-at-a-time mode.");
+}
+
+void ParallelWorker::work_tile_row(const TileRow&, std::size_t, WorkerScratch&) {
+    throw std::logic_error("[wiserow] This worker does not support tile mode.");
+}
+
+WorkerThreadLocal *ParallelWorker::scan_slab(const RowBlock&, const std::size_t, const std::size_t, ScratchArena&) {
+    throw std::logic_error("[wiserow] This worker does not support column-parallel mode.");
+}
+
+void ParallelWorker::merge_slabs(const RowBlock&, WorkerThreadLocal * const *, const std::size_t, WorkerScratch&) {
+    throw std::logic_error("[wiserow] This worker does not support column-parallel mode.");
+}
+// nocov end
+
+double ParallelWorker::cell_cost(const ColumnType type) const {
+    switch(type) {
+    case ColumnType::INTEGER:
+    case ColumnType::DOUBLE:
+        return 1;
+    case ColumnType::COMPLEX:
+    case ColumnType::FACTOR:
+        return 2;
+    case ColumnType::STRING:
+        return 4;
+    }
+
+    return 1; // nocov
+}
+
+double ParallelWorker::row_cost() const {
+    double cost = 0;
+    for (std::size_t j = 0; j < col_collection_.ncol(); j++) {
+        cost += cell_cost(col_collection_.span(j).type());
+    }
+
+    return std::max(cost, 1.0);
 }
 
-// how often to check for user interrupt inside a thread
-int ParallelWorker::interrupt_grain(const int interrupt_check_grain, const int min, const int max) const {
-    int result = interrupt_check_grain / 10;
-    if (result < min) return min;
-    if (result > max) return max;
-    if (result < 1) return 1;
-    return result;
+// rows between checks, blocks and tiles are capped at this many rows
+std::size_t ParallelWorker::check_rows() const {
+    return std::max(static_cast<std::size_t>(CHECK_COST / row_cost()), std::size_t(1));
 }
 
 } // namespace wiserow
@@ -3,22 +3,37 @@
 
 #define STRICT_R_HEADERS // collision between R.h and mingw_32/i686-w64-mingw32/include/windows.h
 
+#include <algorithm> // min
+#include <atomic>
 #include <cstddef> // std::size_t
 #include <exception>
 #include <memory>
+#include <vector>
 
 #include <RcppParallel.h>
 #include <RcppThread.h>
 
 #include "ColumnAbstractions.h"
 #include "OperationMetadata.h"
+#include "RowTile.h"
+#include "WorkerScratch.h"
 
 namespace wiserow {
 
-class WorkerThreadLocal
+// =================================================================================================
+// consecutive output rows processed together in column-at-a-time mode
+
+struct RowBlock
 {
-public:
-    virtual ~WorkerThreadLocal() = default;
+    std::size_t out_begin;
+    std::size_t size;
+    const std::size_t *in_ids; // input row of each output row
+    bool contiguous; // in_ids[r] == in_ids[0] + r for all r
+    const std::size_t *out_ids; // output row of each row if not consecutive, see ParallelWorker's row order
+
+    std::size_t out_id(const std::size_t r) const {
+        return out_ids ? out_ids[r] : out_begin + r;
+    }
 };
 
 // =================================================================================================
@@ -33,31 +48,156 @@ public:
 
     std::size_t num_ops() const;
 
+    // rows per task, a multiple of ChunkedWorker::ROWS, see parallel_for
+    std::size_t grain_size() const;
+    static std::size_t grain_size(const std::size_t num_ops,
+                                  const double row_cost,
+                                  const int num_workers,
+                                  const std::size_t fixed_grain);
+
+    // the orientation only depends on the data's shape, so results don't depend on the number of threads
+    bool use_column_split() const;
+    void run_column_split();
+    void run_row_chunks();
+
     const OperationMetadata metadata;
     std::exception_ptr eptr;
-    bool threw = false;
+    std::atomic<bool> threw { false }; // set once under mutex_, tells every thread to stop
 
 protected:
-    typedef std::shared_ptr<WorkerThreadLocal> thread_local_ptr;
-
     ParallelWorker(const OperationMetadata& metadata, const ColumnCollection& cc);
 
-    virtual thread_local_ptr work_row(std::size_t in_id, std::size_t out_id, thread_local_ptr t_local) = 0;
+    // scratch belongs to the calling thread until the chunk of rows is done
+    virtual void work_row(std::size_t in_id, std::size_t out_id, WorkerScratch& scratch) = 0;
+
+    /*
+     * Column-at-a-time mode: each column is streamed over a block of rows into per-row accumulators,
+     * which avoids hopping across column-major memory for every row.
+     * It is used automatically if the worker supports it and there are at least BLOCK_MIN_COLS columns,
+     * or fewer if narrow_blocks() says each column is cheap enough to stream on its own.
+     */
+    static const std::size_t BLOCK_SIZE;
+    static const std::size_t BLOCK_MIN_COLS;
+
+    virtual bool supports_blocks() const { return false; }
+    virtual bool narrow_blocks() const { return false; }
+    virtual void work_block(const RowBlock& block, WorkerScratch& scratch);
+
+    /*
+     * Tile mode, for operations that need whole rows at once: tiles of rows are copied one column at a time
+     * into a row-major buffer of typed cells, so that each row is then read from contiguous memory.
+     * It is used automatically if the worker supports it and there are at least BLOCK_MIN_COLS columns.
+     */
+    static const std::size_t TILE_BYTES;
+    static const std::size_t TILE_MAX_ROWS;
+
+    virtual bool supports_tiles() const { return false; }
+    virtual void work_tile_row(const TileRow& row, std::size_t out_id, WorkerScratch& scratch);
+
+    /*
+     * Column-parallel mode, for data much wider than tall (see use_column_split), where blocks of rows
+     * would leave threads idle: columns are split in slabs, each task scans one slab of columns for one
+     * block of rows into a partial state that lives in the arena, and once all slabs are done,
+     * the partial states of each block are merged in column order and written to the output.
+     */
+    static const std::size_t COLUMN_SLAB; // minimum columns per slab
+    static const std::size_t WIDE_RATIO; // at least this many times more columns than rows
+    static const std::size_t MAX_SLABS;
+
+    virtual bool supports_column_split() const { return false; }
+    virtual WorkerThreadLocal *scan_slab(const RowBlock& block,
+                                         const std::size_t j_begin,
+                                         const std::size_t j_end,
+                                         ScratchArena& arena);
+    virtual void merge_slabs(const RowBlock& block,
+                             WorkerThreadLocal * const *partials,
+                             const std::size_t num_slabs,
+                             WorkerScratch& scratch);
+
+    /*
+     * Relative cost of visiting one cell of the given type for this kind of operation,
+     * 1 being a plain numeric cell. Only used to estimate how many rows make a task worth scheduling.
+     */
+    virtual double cell_cost(const ColumnType type) const;
 
     const ColumnCollection col_collection_;
     tthread::mutex mutex_;
 
 private:
-    int interrupt_grain(const int interrupt_check_grain, const int min, const int max) const;
+    template<typename F>
+    void guarded(F f);
+
+    RowBlock make_block(const std::size_t block_begin, const std::size_t block_end, WorkerScratch& scratch) const;
+    void fill_tile(const RowBlock& block, TileCell *tile) const;
+
+    // the tasks of run_column_split, slab-major within each block of rows
+    void scan_slab_tasks(std::size_t begin, std::size_t end);
+    void merge_slab_tasks(std::size_t begin, std::size_t end);
+
+    std::size_t slab_width_ = 0;
+    std::size_t num_slabs_ = 0;
+    std::vector<WorkerThreadLocal *> partials_;
+
+    // one scratch per concurrently running chunk, so at most one per thread, reused until the worker is destroyed
+    WorkerScratch& acquire_scratch();
+    void release_scratch(WorkerScratch& scratch);
+
+    std::vector<std::unique_ptr<WorkerScratch>> scratches_;
+    std::vector<WorkerScratch *> free_scratches_;
+    tthread::mutex scratch_mutex_;
+
+    double row_cost() const;
+    std::size_t check_rows() const;
+
+    // polled between groups of rows, see check_rows()
+    bool should_stop() const;
+
+    /*
+     * Rows are processed in the order of their ids, which maps to input and output rows like this:
+     * - all rows or a contiguous range of them: in = first_row_ + id, out = id
+     * - sorted subsets: in = rows[id] - 1, out = id
+     * - unsorted subsets: sorted by input row with their output rows, so columns are read forward
+     */
+    void classify_rows();
+    std::size_t in_row(const std::size_t id) const;
+    std::size_t out_row(const std::size_t id) const;
+
+    bool dense_rows_;
+    std::size_t first_row_;
+    std::vector<std::size_t> sorted_in_rows_;
+    std::vector<std::size_t> sorted_out_rows_;
+
+    std::size_t check_rows_ = 1; // set by run_row_chunks
+};
+
+// =================================================================================================
+// what parallelFor actually splits: chunks of ROWS output rows, so that threads don't write to the same
+// cache lines of the output (relative to its start, R doesn't align vectors to cache lines)
 
-    std::size_t corresponding_row(std::size_t id) const;
+class ChunkedWorker : public RcppParallel::Worker
+{
+public:
+    static const std::size_t ROWS = 16; // 64 bytes of logical or integer output
+
+    ChunkedWorker(ParallelWorker& worker, const std::size_t num_rows)
+        : worker_(worker)
+        , num_rows_(num_rows)
+    { }
+
+    void operator()(std::size_t begin, std::size_t end) override {
+        worker_(begin * ROWS, std::min(end * ROWS, num_rows_));
+    }
 
-    bool is_interrupted(const std::size_t i) const;
+    std::size_t num_chunks() const {
+        return (num_rows_ + ROWS - 1) / ROWS;
+    }
 
-    const int interrupt_grain_;
+private:
+    ParallelWorker& worker_;
+    const std::size_t num_rows_;
 };
 
-// =================================================================================================
+// -------------------------------------------------------------------------------------------------
 
 inline __attribute__((always_inline)) void parallel_for(ParallelWorker& worker) {
     std::size_t num_ops = worker.num_ops();
@@ -65,12 +205,12 @@ inline __attribute__((always_inline)) void parallel_for(ParallelWorker& worker)
         return;
     }
 
-    double grain = num_ops / worker.metadata.num_workers / 10;
-    if (grain < 1000) {
-        grain = 1000;
+    if (worker.use_column_split()) {
+        worker.run_column_split();
+    }
+    else {
+        worker.run_row_chunks();
     }
-
-    RcppParallel::parallelFor(0, num_ops, worker, static_cast<std::size_t>(grain));
 
     if (worker.threw) {
         if (worker.eptr)
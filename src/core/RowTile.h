@@ -0,0 +1,92 @@
+#ifndef WISEROW_ROWTILE_H_
+#define WISEROW_ROWTILE_H_
+
+#include <complex>
+#include <cstddef> // size_t
+
+#include "ColumnAbstractions.h"
+
+namespace wiserow {
+
+// =================================================================================================
+// one cell of a row-major tile, typed like its column's span; factors keep their codes
+
+union TileCell
+{
+    int integer;
+    double real;
+    SEXP string;
+    double complex[2];
+};
+
+// -------------------------------------------------------------------------------------------------
+// the cells of one row, read either from a tile or from the columns themselves,
+// so that row kernels can be templates over both; callers must have checked the span's type
+
+class TileRow
+{
+public:
+    explicit TileRow(TileCell const * const cells)
+        : cells_(cells)
+    { }
+
+    int integer(const std::size_t j) const {
+        return cells_[j].integer;
+    }
+
+    double real(const std::size_t j) const {
+        return cells_[j].real;
+    }
+
+    SEXP string(const std::size_t j) const {
+        return cells_[j].string;
+    }
+
+    std::complex<double> complex(const std::size_t j) const {
+        return std::complex<double>(cells_[j].complex[0], cells_[j].complex[1]);
+    }
+
+    int code(const std::size_t j) const {
+        return cells_[j].integer;
+    }
+
+private:
+    TileCell const * const cells_;
+};
+
+class ColumnRow
+{
+public:
+    ColumnRow(const ColumnCollection& col_collection, const std::size_t in_id)
+        : col_collection_(col_collection)
+        , in_id_(in_id)
+    { }
+
+    int integer(const std::size_t j) const {
+        return col_collection_.span(j).as<int>()[in_id_];
+    }
+
+    double real(const std::size_t j) const {
+        return col_collection_.span(j).as<double>()[in_id_];
+    }
+
+    SEXP string(const std::size_t j) const {
+        return col_collection_.span(j).as<SEXP>()[in_id_];
+    }
+
+    std::complex<double> complex(const std::size_t j) const {
+        return col_collection_.span(j).as<std::complex<double>>()[in_id_];
+    }
+
+    int code(const std::size_t j) const {
+        return col_collection_.span(j).as_factor().codes()[in_id_];
+    }
+
+private:
+    const ColumnCollection& col_collection_;
+    const std::size_t in_id_;
+};
+
+} // namespace wiserow
+
+#endif // WISEROW_ROWTILE_H_
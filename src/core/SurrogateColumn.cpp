@@ -15,6 +15,9 @@ namespace wiserow {
  *
  * To get the final char* from SEXP*, we use CHAR() again. This, along with STDVEC_DATAPTR, are only casts
  * with some arithmetic, so they should be thread safe (?).
+ *
+ * The spans returned by span() get the data pointer with STRING_PTR_RO once, in the main thread,
+ * so workers only dereference plain SEXP arrays.
  */
 
 SurrogateColumn<Rcpp::StringMatrix>::SurrogateColumn(SEXP mat, const int j)
@@ -37,6 +40,12 @@ const supported_col_t SurrogateColumn<Rcpp::StringMatrix>::operator[](const std:
     return supported_col_t(boost::string_ref(CHAR(element)));
 }
 
+// -------------------------------------------------------------------------------------------------
+
+ColumnSpan SurrogateColumn<Rcpp::StringMatrix>::span() const {
+    return ColumnSpan(STRING_PTR_RO(data_) + offset_, size_);
+}
+
 // =================================================================================================
 
 SurrogateColumn<Rcpp::StringVector>::SurrogateColumn(SEXP vec)
@@ -58,6 +67,41 @@ const supported_col_t SurrogateColumn<Rcpp::StringVector>::operator[](const std:
     return supported_col_t(boost::string_ref(CHAR(element)));
 }
 
+// -------------------------------------------------------------------------------------------------
+
+ColumnSpan SurrogateColumn<Rcpp::StringVector>::span() const {
+    return ColumnSpan(STRING_PTR_RO(data_), size_);
+}
+
+// =================================================================================================
+
+SurrogateColumn<FactorColumn>::SurrogateColumn(const Rcpp::IntegerVector& codes)
+    : levels_(codes.attr("levels"))
+    , codes_(&codes[0])
+    , size_(codes.length())
+{ }
+
+// -------------------------------------------------------------------------------------------------
+
+const supported_col_t SurrogateColumn<FactorColumn>::operator[](const std::size_t id) const {
+    if (id >= size_) { // nocov start
+        throw std::out_of_range("[wiserow] column of size " +
+                                std::to_string(size_) +
+                                " cannot be indexed at " +
+                                std::to_string(id));
+    } // nocov end
+
+    int code = codes_[id];
+    SEXP element = code == NA_INTEGER ? NA_STRING : STRING_ELT(static_cast<SEXP>(levels_), code - 1);
+    return supported_col_t(boost::string_ref(CHAR(element)));
+}
+
+// -------------------------------------------------------------------------------------------------
+
+ColumnSpan SurrogateColumn<FactorColumn>::span() const {
+    return ColumnSpan(codes_, STRING_PTR_RO(static_cast<SEXP>(levels_)), levels_.length(), size_);
+}
+
 // =================================================================================================
 
 SurrogateColumn<Rcpp::ComplexMatrix>::SurrogateColumn(const Rcpp::ComplexMatrix& mat, const int j)
@@ -78,6 +122,12 @@ const supported_col_t SurrogateColumn<Rcpp::ComplexMatrix>::operator[](const std
     return supported_col_t(data_ptr_[id]);
 }
 
+// -------------------------------------------------------------------------------------------------
+
+ColumnSpan SurrogateColumn<Rcpp::ComplexMatrix>::span() const {
+    return ColumnSpan(data_ptr_, size_);
+}
+
 // =================================================================================================
 
 SurrogateColumn<Rcpp::ComplexVector>::SurrogateColumn(const Rcpp::ComplexVector& vec)
@@ -98,4 +148,10 @@ const supported_col_t SurrogateColumn<Rcpp::ComplexVector>::operator[](const std
     return supported_col_t(data_ptr_[id]);
 }
 
+// -------------------------------------------------------------------------------------------------
+
+ColumnSpan SurrogateColumn<Rcpp::ComplexVector>::span() const {
+    return ColumnSpan(data_ptr_, size_);
+}
+
 } // namespace wiserow
@@ -39,7 +39,19 @@ public:
         return is_logical_;
     }
 
+    ColumnSpan span() const override {
+        return make_span(data_ptr_);
+    }
+
 private:
+    ColumnSpan make_span(int const * const data_ptr) const {
+        return ColumnSpan(data_ptr, size_, is_logical_);
+    }
+
+    ColumnSpan make_span(double const * const data_ptr) const {
+        return ColumnSpan(data_ptr, size_);
+    }
+
     T const * const data_ptr_;
     const std::size_t size_;
     const bool is_logical_;
@@ -55,6 +67,7 @@ public:
     SurrogateColumn(SEXP mat, const int j);
 
     const supported_col_t operator[](const std::size_t id) const override;
+    ColumnSpan span() const override;
 
 private:
     const SEXP data_;
@@ -72,12 +85,31 @@ public:
     SurrogateColumn(SEXP vec);
 
     const supported_col_t operator[](const std::size_t id) const override;
+    ColumnSpan span() const override;
 
 private:
     const SEXP data_;
     const std::size_t size_;
 };
 
+// -------------------------------------------------------------------------------------------------
+// Specialization for factors that should be treated as characters, levels are resolved on access
+
+template<>
+class SurrogateColumn<FactorColumn> : public VariantColumn
+{
+public:
+    SurrogateColumn(const Rcpp::IntegerVector& codes);
+
+    const supported_col_t operator[](const std::size_t id) const override;
+    ColumnSpan span() const override;
+
+private:
+    const Rcpp::StringVector levels_;
+    int const * const codes_;
+    const std::size_t size_;
+};
+
 // -------------------------------------------------------------------------------------------------
 // Specialization for Rcpp::ComplexMatrix
 // see http://rcpp-devel.r-forge.r-project.narkive.com/o5ubHVos/multiplication-of-complexvector
@@ -89,6 +121,7 @@ public:
     SurrogateColumn(const Rcpp::ComplexMatrix& mat, const int j);
 
     const supported_col_t operator[](const std::size_t id) const override;
+    ColumnSpan span() const override;
 
 private:
     const std::complex<double> *data_ptr_;
@@ -106,6 +139,7 @@ public:
     SurrogateColumn(const Rcpp::ComplexVector& vec);
 
     const supported_col_t operator[](const std::size_t id) const override;
+    ColumnSpan span() const override;
 
 private:
     const std::complex<double> *data_ptr_;
@@ -0,0 +1,74 @@
+#include "WorkerScratch.h"
+
+namespace wiserow {
+
+ScratchArena::~ScratchArena() {
+    // objects may give memory back to the arena while being destroyed, so chunks are released last
+    while (objects_) {
+        NodeBase *next = objects_->next;
+        objects_->~NodeBase();
+        objects_ = next;
+    }
+
+    for (void *chunk : chunks_) {
+        ::operator delete(chunk);
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+
+std::size_t ScratchArena::size_class(const std::size_t bytes) {
+    std::size_t klass = 0;
+    std::size_t class_size = ALIGNMENT;
+
+    while (class_size < bytes) {
+        class_size <<= 1;
+        klass++;
+    }
+
+    return klass;
+}
+
+// -------------------------------------------------------------------------------------------------
+
+void *ScratchArena::allocate(const std::size_t bytes) {
+    std::size_t klass = size_class(bytes);
+    if (klass >= NUM_CLASSES) {
+        return ::operator new(bytes);
+    }
+
+    FreeBlock *block = free_lists_[klass];
+    if (block) {
+        free_lists_[klass] = block->next;
+        return block;
+    }
+
+    std::size_t class_size = ALIGNMENT << klass;
+    if (static_cast<std::size_t>(chunk_end_ - cursor_) < class_size) {
+        cursor_ = static_cast<char *>(::operator new(CHUNK_SIZE));
+        chunk_end_ = cursor_ + CHUNK_SIZE;
+        chunks_.push_back(cursor_);
+    }
+
+    void *ans = cursor_;
+    cursor_ += class_size;
+    return ans;
+}
+
+// -------------------------------------------------------------------------------------------------
+
+void ScratchArena::deallocate(void *ptr, const std::size_t bytes) {
+    if (!ptr) return;
+
+    std::size_t klass = size_class(bytes);
+    if (klass >= NUM_CLASSES) {
+        ::operator delete(ptr);
+        return;
+    }
+
+    FreeBlock *block = static_cast<FreeBlock *>(ptr);
+    block->next = free_lists_[klass];
+    free_lists_[klass] = block;
+}
+
+} // namespace wiserow
@@ -0,0 +1,155 @@
+#ifndef WISEROW_WORKERSCRATCH_H_
+#define WISEROW_WORKERSCRATCH_H_
+
+#include <cstddef> // size_t
+#include <memory> // shared_ptr
+#include <new> // placement new
+#include <utility> // forward
+#include <vector>
+
+namespace wiserow {
+
+class WorkerThreadLocal
+{
+public:
+    virtual ~WorkerThreadLocal() = default;
+};
+
+// =================================================================================================
+// bump allocator with free lists per size class, meant to be used by a single thread at a time;
+// memory only goes back to the system when the arena is destroyed
+
+class ScratchArena
+{
+public:
+    ScratchArena() = default;
+    ScratchArena(const ScratchArena&) = delete;
+    ScratchArena& operator=(const ScratchArena&) = delete;
+    ~ScratchArena();
+
+    void *allocate(const std::size_t bytes);
+    void deallocate(void *ptr, const std::size_t bytes);
+
+    // objects created here are destroyed together with the arena, in reverse order
+    template<typename T, typename... Args>
+    T *create(Args&&... args) {
+        Node<T> *node = new (allocate(sizeof(Node<T>))) Node<T>(std::forward<Args>(args)...);
+        node->next = objects_;
+        objects_ = node;
+        return &node->obj;
+    }
+
+private:
+    static const std::size_t ALIGNMENT = 16;
+    static const std::size_t NUM_CLASSES = 12; // 16 bytes to 32 KiB
+    static const std::size_t CHUNK_SIZE = 256 * 1024;
+
+    struct NodeBase
+    {
+        virtual ~NodeBase() = default;
+        NodeBase *next = nullptr;
+    };
+
+    template<typename T>
+    struct Node : public NodeBase
+    {
+        template<typename... Args>
+        Node(Args&&... args) : obj(std::forward<Args>(args)...) {}
+        T obj;
+    };
+
+    struct FreeBlock
+    {
+        FreeBlock *next;
+    };
+
+    static std::size_t size_class(const std::size_t bytes);
+
+    std::vector<void *> chunks_;
+    char *cursor_ = nullptr;
+    char *chunk_end_ = nullptr;
+
+    FreeBlock *free_lists_[NUM_CLASSES] = {};
+    NodeBase *objects_ = nullptr;
+};
+
+// -------------------------------------------------------------------------------------------------
+// so that standard containers can take their memory from an arena
+
+template<typename T>
+class ScratchAllocator
+{
+public:
+    typedef T value_type;
+
+    ScratchAllocator(ScratchArena& arena) : arena(&arena) {}
+
+    template<typename U>
+    ScratchAllocator(const ScratchAllocator<U>& other) : arena(other.arena) {}
+
+    T *allocate(const std::size_t n) {
+        return static_cast<T *>(arena->allocate(n * sizeof(T)));
+    }
+
+    void deallocate(T *ptr, const std::size_t n) {
+        arena->deallocate(ptr, n * sizeof(T));
+    }
+
+    ScratchArena *arena;
+};
+
+template<typename T, typename U>
+bool operator==(const ScratchAllocator<T>& a, const ScratchAllocator<U>& b) {
+    return a.arena == b.arena;
+}
+
+template<typename T, typename U>
+bool operator!=(const ScratchAllocator<T>& a, const ScratchAllocator<U>& b) {
+    return a.arena != b.arena;
+}
+
+template<typename T>
+using scratch_vector = std::vector<T, ScratchAllocator<T>>;
+
+// =================================================================================================
+// what a worker thread keeps during a whole parallel_for, see ParallelWorker
+
+class WorkerScratch
+{
+public:
+    /*
+     * A worker can keep one object per thread here, created the first time it's needed.
+     * T must be constructible from the arena.
+     */
+    template<typename T>
+    T& state() {
+        if (!state_) {
+            state_ = arena.create<T>(arena);
+        }
+
+        return *static_cast<T *>(state_);
+    }
+
+    // one more object per thread, prototype's clone, which can be null
+    template<typename T>
+    T *clone_of(const std::shared_ptr<T>& prototype) {
+        if (!clone_set_) {
+            clone_ = prototype->clone(arena);
+            clone_set_ = true;
+        }
+
+        return static_cast<T *>(clone_);
+    }
+
+    ScratchArena arena;
+    std::vector<std::size_t> row_ids; // for ParallelWorker's blocks
+
+private:
+    WorkerThreadLocal *state_ = nullptr;
+    WorkerThreadLocal *clone_ = nullptr;
+    bool clone_set_ = false;
+};
+
+} // namespace wiserow
+
+#endif // WISEROW_WORKERSCRATCH_H_
@@ -9,8 +9,7 @@
 #include "MatrixColumnCollection.cpp"
 
 #include "ParallelWorker.cpp"
-
-#include "OutputWrapper.cpp"
+#include "WorkerScratch.cpp"
 
 namespace wiserow {
 
@@ -1,4 +1,5 @@
 #include "../wiserow.h"
 
+#include "internal.cpp"
 #include "mixed_out.cpp"
 #include "numeric_out.cpp"
@@ -0,0 +1,20 @@
+#include "../wiserow.h"
+
+#include <cstddef> // size_t
+
+#include <Rcpp.h>
+
+#include "../core.h"
+
+namespace wiserow {
+
+// internal, how many tasks parallel_for would schedule with the automatic grain
+extern "C" SEXP num_tasks(SEXP num_rows, SEXP row_cost, SEXP num_workers) {
+    BEGIN_RCPP
+    std::size_t num_ops = static_cast<std::size_t>(Rcpp::as<double>(num_rows));
+    std::size_t grain = ParallelWorker::grain_size(num_ops, Rcpp::as<double>(row_cost), Rcpp::as<int>(num_workers), 0);
+    return Rcpp::wrap(static_cast<double>((num_ops + grain - 1) / grain));
+    END_RCPP
+}
+
+} // namespace wiserow
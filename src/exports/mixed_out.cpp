@@ -11,52 +11,101 @@
 
 namespace wiserow {
 
-std::shared_ptr<OutputWrapper<int>> get_wrapper_ptr(const OperationMetadata& metadata, SEXP output) {
-    switch(metadata.output_class) {
-    case RClass::VECTOR: {
-        if (metadata.output_mode == LGLSXP) {
-            Rcpp::LogicalVector ans(output);
-            return std::make_shared<VectorOutputWrapper<LGLSXP, int>>(ans);
-        }
-        else {
-            Rcpp::IntegerVector ans(output);
-            return std::make_shared<VectorOutputWrapper<INTSXP, int>>(ans);
-        }
-    }
-    case RClass::LIST: {
-        Rcpp::List ans(output);
+template<template<typename, typename> class Worker, typename Strategy, typename Sink, typename... Args>
+void run_with_strategy(const std::shared_ptr<Strategy>& out_strategy,
+                       const OperationMetadata& metadata,
+                       const ColumnCollection& col_collection,
+                       Sink& ans,
+                       const Args&... args)
+{
+    Worker<Strategy, Sink> worker(metadata, col_collection, ans, args..., out_strategy);
+    parallel_for(worker);
+}
 
-        if (metadata.output_mode == LGLSXP) {
-            return std::make_shared<ListOutputWrapper<LGLSXP, int>>(ans);
-        }
-        else {
-            return std::make_shared<ListOutputWrapper<INTSXP, int>>(ans);
-        }
+// workers get the strategy as a template parameter, so the match type is only checked here
+template<template<typename, typename> class Worker, typename Sink, typename... Args>
+void run_with_match_type(const std::string& match_type,
+                         const NaAction na_action,
+                         const OperationMetadata& metadata,
+                         const ColumnCollection& col_collection,
+                         Sink& ans,
+                         const Args&... args)
+{
+    if (match_type == "all") {
+        auto out_strategy = std::make_shared<BulkBoolStrategy<BulkBoolOp::ALL>>(na_action);
+        run_with_strategy<Worker>(out_strategy, metadata, col_collection, ans, args...);
     }
-    case RClass::DATAFRAME: {
-        if (metadata.output_mode == LGLSXP) {
-            return std::make_shared<DataFrameOutputWrapper<LGLSXP, int>>(output);
-        }
-        else {
-            return std::make_shared<DataFrameOutputWrapper<INTSXP, int>>(output);
-        }
+    else if (match_type == "any") {
+        auto out_strategy = std::make_shared<BulkBoolStrategy<BulkBoolOp::ANY>>(na_action);
+        run_with_strategy<Worker>(out_strategy, metadata, col_collection, ans, args...);
     }
-    case RClass::MATRIX: {
-        if (metadata.output_mode == LGLSXP) {
-            return std::make_shared<MatrixOutputWrapper<LGLSXP, int>>(output);
-        }
-        else {
-            return std::make_shared<MatrixOutputWrapper<INTSXP, int>>(output);
-        }
+    else if (match_type == "none") {
+        auto out_strategy = std::make_shared<BulkBoolStrategy<BulkBoolOp::NONE>>(na_action);
+        run_with_strategy<Worker>(out_strategy, metadata, col_collection, ans, args...);
     }
+    else if (match_type == "which_first") {
+        auto out_strategy = std::make_shared<WhichFirstStrategy>();
+        run_with_strategy<Worker>(out_strategy, metadata, col_collection, ans, args...);
+    }
+    else if (match_type == "count") {
+        auto out_strategy = std::make_shared<CountStrategy>();
+        run_with_strategy<Worker>(out_strategy, metadata, col_collection, ans, args...);
+    }
+    else { // nocov start
+        Rcpp::stop("Match type [" + match_type + "] not supported.");
+    } // nocov end
+}
+
+// -------------------------------------------------------------------------------------------------
+
+// and the concrete output wrapper, so that writes are not virtual either, see integer-workers.h
+template<template<typename, typename> class Worker, template<int, typename> class Wrapper, typename... Args>
+void run_into_wrapper(const std::string& match_type,
+                      const NaAction na_action,
+                      const OperationMetadata& metadata,
+                      const ColumnCollection& col_collection,
+                      SEXP output,
+                      const Args&... args)
+{
+    if (metadata.output_mode == LGLSXP) {
+        Wrapper<LGLSXP, int> ans(output);
+        run_with_match_type<Worker>(match_type, na_action, metadata, col_collection, ans, args...);
+    }
+    else {
+        Wrapper<INTSXP, int> ans(output);
+        run_with_match_type<Worker>(match_type, na_action, metadata, col_collection, ans, args...);
+    }
+}
+
+template<template<typename, typename> class Worker, typename... Args>
+void run_into_output(const std::string& match_type,
+                     const NaAction na_action,
+                     const OperationMetadata& metadata,
+                     const ColumnCollection& col_collection,
+                     SEXP output,
+                     const Args&... args)
+{
+    switch(metadata.output_class) {
+    case RClass::VECTOR:
+        run_into_wrapper<Worker, VectorOutputWrapper>(match_type, na_action, metadata, col_collection, output, args...);
+        break;
+    case RClass::LIST:
+        run_into_wrapper<Worker, ListOutputWrapper>(match_type, na_action, metadata, col_collection, output, args...);
+        break;
+    case RClass::DATAFRAME:
+        run_into_wrapper<Worker, DataFrameOutputWrapper>(match_type, na_action, metadata, col_collection, output, args...);
+        break;
+    case RClass::MATRIX:
+        run_into_wrapper<Worker, MatrixOutputWrapper>(match_type, na_action, metadata, col_collection, output, args...);
+        break;
     default: // nocov start
         Rcpp::stop("This operation does not support the chosen output class.");
     } // nocov end
 }
 
-// =================================================================================================
+// -------------------------------------------------------------------------------------------------
 
-template<typename Worker>
+template<template<typename, typename> class Worker>
 void visit_with_match_type(SEXP metadata, SEXP data, SEXP output, const Rcpp::List extras) {
     std::string match_type = Rcpp::as<std::string>(extras["match_type"]);
 
@@ -66,37 +115,8 @@ void visit_with_match_type(SEXP metadata, SEXP data, SEXP output, const Rcpp::Li
     std::size_t out_len = output_length(metadata_, col_collection);
     if (out_len == 0) return;
 
-    std::shared_ptr<OutputWrapper<int>> wrapper_ptr = get_wrapper_ptr(metadata_, output);
-
     // always NaAction::Exclude to force short-circuit if appropriate
-    if (match_type == "which_first") {
-        auto out_strategy = std::make_shared<WhichFirstStrategy>();
-        Worker worker(metadata_, col_collection, *wrapper_ptr, out_strategy);
-        parallel_for(worker);
-    }
-    else if (match_type == "count") {
-        auto out_strategy = std::make_shared<CountStrategy>();
-        Worker worker(metadata_, col_collection, *wrapper_ptr, out_strategy);
-        parallel_for(worker);
-    }
-    else if (match_type == "all") {
-        auto out_strategy = std::make_shared<BulkBoolStrategy>(BulkBoolOp::ALL, NaAction::EXCLUDE);
-        Worker worker(metadata_, col_collection, *wrapper_ptr, out_strategy);
-        parallel_for(worker);
-    }
-    else if (match_type == "any") {
-        auto out_strategy = std::make_shared<BulkBoolStrategy>(BulkBoolOp::ANY, NaAction::EXCLUDE);
-        Worker worker(metadata_, col_collection, *wrapper_ptr, out_strategy);
-        parallel_for(worker);
-    }
-    else if (match_type == "none") {
-        auto out_strategy = std::make_shared<BulkBoolStrategy>(BulkBoolOp::NONE, NaAction::EXCLUDE);
-        Worker worker(metadata_, col_collection, *wrapper_ptr, out_strategy);
-        parallel_for(worker);
-    }
-    else { // nocov start
-        Rcpp::stop("Match type [" + match_type + "] not supported.");
-    } // nocov end
+    run_into_output<Worker>(match_type, NaAction::EXCLUDE, metadata_, col_collection, output);
 }
 
 // -------------------------------------------------------------------------------------------------
@@ -141,36 +161,8 @@ extern "C" SEXP row_compare(SEXP metadata, SEXP data, SEXP output, SEXP extras)
     SEXP comp_op = extras_["comp_op"];
     SEXP target_val = extras_["target_val"];
 
-    std::shared_ptr<OutputWrapper<int>> wrapper_ptr = get_wrapper_ptr(metadata_, output);
-
-    if (match_type == "all") {
-        auto out_strategy = std::make_shared<BulkBoolStrategy>(BulkBoolOp::ALL, metadata_.na_action);
-        CompBasedWorker worker(metadata_, col_collection, *wrapper_ptr, comp_op, target_val, out_strategy);
-        parallel_for(worker);
-    }
-    else if (match_type == "any") {
-        auto out_strategy = std::make_shared<BulkBoolStrategy>(BulkBoolOp::ANY, metadata_.na_action);
-        CompBasedWorker worker(metadata_, col_collection, *wrapper_ptr, comp_op, target_val, out_strategy);
-        parallel_for(worker);
-    }
-    else if (match_type == "none") {
-        auto out_strategy = std::make_shared<BulkBoolStrategy>(BulkBoolOp::NONE, metadata_.na_action);
-        CompBasedWorker worker(metadata_, col_collection, *wrapper_ptr, comp_op, target_val, out_strategy);
-        parallel_for(worker);
-    }
-    else if (match_type == "which_first") {
-        auto out_strategy = std::make_shared<WhichFirstStrategy>();
-        CompBasedWorker worker(metadata_, col_collection, *wrapper_ptr, comp_op, target_val, out_strategy);
-        parallel_for(worker);
-    }
-    else if (match_type == "count") {
-        auto out_strategy = std::make_shared<CountStrategy>();
-        CompBasedWorker worker(metadata_, col_collection, *wrapper_ptr, comp_op, target_val, out_strategy);
-        parallel_for(worker);
-    }
-    else { // nocov start
-        Rcpp::stop("Match type [" + match_type + "] not supported.");
-    } // nocov end
+    run_into_output<CompBasedWorker>(match_type, metadata_.na_action, metadata_, col_collection, output,
+                                     comp_op, target_val);
 
     return R_NilValue;
     END_RCPP
@@ -191,36 +183,8 @@ extern "C" SEXP row_in(SEXP metadata, SEXP data, SEXP output, SEXP extras) {
     SEXP target_sets = extras_["target_sets"];
     bool negate = Rcpp::as<bool>(extras_["negate"]);
 
-    std::shared_ptr<OutputWrapper<int>> wrapper_ptr = get_wrapper_ptr(metadata_, output);
-
-    if (match_type == "all") {
-        auto out_strategy = std::make_shared<BulkBoolStrategy>(BulkBoolOp::ALL, metadata_.na_action);
-        InSetWorker worker(metadata_, col_collection, *wrapper_ptr, target_sets, negate, out_strategy);
-        parallel_for(worker);
-    }
-    else if (match_type == "any") {
-        auto out_strategy = std::make_shared<BulkBoolStrategy>(BulkBoolOp::ANY, metadata_.na_action);
-        InSetWorker worker(metadata_, col_collection, *wrapper_ptr, target_sets, negate, out_strategy);
-        parallel_for(worker);
-    }
-    else if (match_type == "none") {
-        auto out_strategy = std::make_shared<BulkBoolStrategy>(BulkBoolOp::NONE, metadata_.na_action);
-        InSetWorker worker(metadata_, col_collection, *wrapper_ptr, target_sets, negate, out_strategy);
-        parallel_for(worker);
-    }
-    else if (match_type == "which_first") {
-        auto out_strategy = std::make_shared<WhichFirstStrategy>();
-        InSetWorker worker(metadata_, col_collection, *wrapper_ptr, target_sets, negate, out_strategy);
-        parallel_for(worker);
-    }
-    else if (match_type == "count") {
-        auto out_strategy = std::make_shared<CountStrategy>();
-        InSetWorker worker(metadata_, col_collection, *wrapper_ptr, target_sets, negate, out_strategy);
-        parallel_for(worker);
-    }
-    else { // nocov start
-        Rcpp::stop("Match type [" + match_type + "] not supported.");
-    } // nocov end
+    run_into_output<InSetWorker>(match_type, metadata_.na_action, metadata_, col_collection, output,
+                                 target_sets, negate);
 
     return R_NilValue;
     END_RCPP
@@ -239,35 +203,27 @@ extern "C" SEXP row_duplicated(SEXP metadata, SEXP data, SEXP output, SEXP extra
     Rcpp::List extras_(extras);
     std::string match_type = Rcpp::as<std::string>(extras_["match_type"]);
 
-    std::shared_ptr<OutputWrapper<int>> wrapper_ptr = get_wrapper_ptr(metadata_, output);
-
-    if (match_type == "NULL") {
-        auto out_strategy = std::make_shared<IdentityStrategy>();
-        DuplicatedWorker worker(metadata_, col_collection, *wrapper_ptr, out_strategy);
-        parallel_for(worker);
-    }
-    else if (match_type == "any") {
-        auto out_strategy = std::make_shared<BulkBoolStrategy>(BulkBoolOp::ANY, metadata_.na_action);
-        DuplicatedWorker worker(metadata_, col_collection, *wrapper_ptr, out_strategy);
-        parallel_for(worker);
-    }
-    else if (match_type == "none") {
-        auto out_strategy = std::make_shared<BulkBoolStrategy>(BulkBoolOp::NONE, metadata_.na_action);
-        DuplicatedWorker worker(metadata_, col_collection, *wrapper_ptr, out_strategy);
-        parallel_for(worker);
+    if (match_type != "NULL") {
+        run_into_output<DuplicatedWorker>(match_type, metadata_.na_action, metadata_, col_collection, output);
+        return R_NilValue;
     }
-    else if (match_type == "which_first") {
-        auto out_strategy = std::make_shared<WhichFirstStrategy>();
-        DuplicatedWorker worker(metadata_, col_collection, *wrapper_ptr, out_strategy);
-        parallel_for(worker);
+
+    // one logical per column, R only allows matrices and data frames here
+    auto out_strategy = std::make_shared<IdentityStrategy>();
+
+    switch(metadata_.output_class) {
+    case RClass::DATAFRAME: {
+        DataFrameOutputWrapper<LGLSXP, int> ans(output);
+        run_with_strategy<DuplicatedWorker>(out_strategy, metadata_, col_collection, ans);
+        break;
     }
-    else if (match_type == "count") {
-        auto out_strategy = std::make_shared<CountStrategy>();
-        DuplicatedWorker worker(metadata_, col_collection, *wrapper_ptr, out_strategy);
-        parallel_for(worker);
+    case RClass::MATRIX: {
+        MatrixOutputWrapper<LGLSXP, int> ans(output);
+        run_with_strategy<DuplicatedWorker>(out_strategy, metadata_, col_collection, ans);
+        break;
     }
-    else { // nocov start
-        Rcpp::stop("Match type [" + match_type + "] not supported.");
+    default: // nocov start
+        Rcpp::stop("This operation does not support the chosen output class.");
     } // nocov end
 
     return R_NilValue;
@@ -276,6 +232,17 @@ extern "C" SEXP row_duplicated(SEXP metadata, SEXP data, SEXP output, SEXP extra
 
 // =================================================================================================
 
+template<typename T, bool WHICH, typename Sink>
+void run_row_extrema(const OperationMetadata& metadata,
+                     const ColumnCollection& col_collection,
+                     const Rcpp::List& extras,
+                     SEXP output)
+{
+    Sink ans(output);
+    RowExtremaWorker<T, WHICH, Sink> worker(metadata, col_collection, ans, extras);
+    parallel_for(worker);
+}
+
 template<int RT, typename T, bool WHICH>
 void numeric_row_extrema(const OperationMetadata& metadata,
                          const ColumnCollection& col_collection,
@@ -284,33 +251,26 @@ void numeric_row_extrema(const OperationMetadata& metadata,
 {
     typedef typename std::conditional<WHICH, int, T>::type OUT_T;
 
-    std::shared_ptr<OutputWrapper<OUT_T>> output_wrapper = nullptr;
-
     switch(metadata.output_class) {
     case RClass::VECTOR: {
-        Rcpp::Vector<RT> ans(output);
-        output_wrapper = std::make_shared<VectorOutputWrapper<RT, OUT_T>>(ans);
+        run_row_extrema<T, WHICH, VectorOutputWrapper<RT, OUT_T>>(metadata, col_collection, extras, output);
         break;
     }
     case RClass::LIST: {
-        output_wrapper = std::make_shared<ListOutputWrapper<RT, OUT_T>>(output);
+        run_row_extrema<T, WHICH, ListOutputWrapper<RT, OUT_T>>(metadata, col_collection, extras, output);
         break;
     }
     case RClass::DATAFRAME: {
-        output_wrapper = std::make_shared<DataFrameOutputWrapper<RT, OUT_T>>(output);
+        run_row_extrema<T, WHICH, DataFrameOutputWrapper<RT, OUT_T>>(metadata, col_collection, extras, output);
         break;
     }
     case RClass::MATRIX: {
-        Rcpp::Matrix<RT> ans(output);
-        output_wrapper = std::make_shared<MatrixOutputWrapper<RT, OUT_T>>(ans);
+        run_row_extrema<T, WHICH, MatrixOutputWrapper<RT, OUT_T>>(metadata, col_collection, extras, output);
         break;
     }
     default: // nocov start
         Rcpp::stop("This operation does not support the chosen output class.");
     } // nocov end
-
-    RowExtremaWorker<T, WHICH> worker(metadata, col_collection, *output_wrapper, extras);
-    parallel_for(worker);
 }
 
 extern "C" SEXP row_extrema(SEXP metadata, SEXP data, SEXP output, SEXP extras) {
@@ -357,56 +317,29 @@ extern "C" SEXP row_extrema(SEXP metadata, SEXP data, SEXP output, SEXP extras)
         parallel_for(worker);
 
         switch(metadata_.output_class) {
-        case RClass::VECTOR: {
-            Rcpp::StringVector ans(output);
-            for (R_xlen_t i = 0; i < ans.length(); i++) {
-                const char * data = worker.ans[i].data();
-                if (data != worker.STRING_REF_NOT_SET.data()) {
-                    ans[i] = data;
-                }
-                else {
-                    ans[i] = NA_STRING;
+        case RClass::VECTOR:
+        case RClass::MATRIX: { // a column per extremum
+            for (std::size_t k = 0; k < worker.num_extrema(); k++) {
+                for (std::size_t i = 0; i < out_len; i++) {
+                    SET_STRING_ELT(output, k * out_len + i, worker.result(i, k));
                 }
             }
             break;
         }
         case RClass::LIST: {
-            Rcpp::List list(output);
-            for (R_xlen_t i = 0; i < list.length(); i++) {
-                const char * data = worker.ans[i].data();
-                Rcpp::StringVector ans(list[i]);
-                if (data != worker.STRING_REF_NOT_SET.data()) {
-                    ans[0] = data;
-                }
-                else {
-                    ans[0] = NA_STRING;
+            for (std::size_t i = 0; i < out_len; i++) {
+                SEXP ans = VECTOR_ELT(output, i);
+                for (std::size_t k = 0; k < worker.num_extrema(); k++) {
+                    SET_STRING_ELT(ans, k, worker.result(i, k));
                 }
             }
             break;
         }
         case RClass::DATAFRAME: {
-            Rcpp::DataFrame df(output);
-            Rcpp::StringVector ans(df[0]);
-            for (R_xlen_t i = 0; i < ans.length(); i++) {
-                const char * data = worker.ans[i].data();
-                if (data != worker.STRING_REF_NOT_SET.data()) {
-                    ans[i] = data;
-                }
-                else {
-                    ans[i] = NA_STRING;
-                }
-            }
-            break;
-        }
-        case RClass::MATRIX: {
-            Rcpp::StringMatrix ans(output);
-            for (int i = 0; i < ans.nrow(); i++) {
-                const char * data = worker.ans[i].data();
-                if (data != worker.STRING_REF_NOT_SET.data()) {
-                    ans[i] = data;
-                }
-                else {
-                    ans[i] = NA_STRING;
+            for (std::size_t k = 0; k < worker.num_extrema(); k++) {
+                SEXP ans = VECTOR_ELT(output, k);
+                for (std::size_t i = 0; i < out_len; i++) {
+                    SET_STRING_ELT(ans, i, worker.result(i, k));
                 }
             }
             break;
@@ -11,6 +11,18 @@
 namespace wiserow {
 
 template<typename Worker, typename Wrapper>
+void run_numeric_worker(const OperationMetadata& metadata,
+                        const ColumnCollection& col_collection,
+                        Wrapper& wrapper,
+                        SEXP extras)
+{
+    Worker worker(metadata, col_collection, wrapper, extras);
+    parallel_for(worker);
+}
+
+// -------------------------------------------------------------------------------------------------
+
+template<template<typename, typename, typename> class Worker, typename T, typename Wrapper, bool LOGICAL>
 void visit_into_numeric(const OperationMetadata& metadata,
                         const ColumnCollection& col_collection,
                         SEXP output,
@@ -20,29 +32,46 @@ void visit_into_numeric(const OperationMetadata& metadata,
     if (out_len == 0) return;
 
     Wrapper wrapper(output);
-    Worker worker(metadata, col_collection, wrapper, extras);
-    parallel_for(worker);
+    bool cumulative = Rcpp::as<bool>(Rcpp::List(extras)["cumulative"]);
+
+    // workers are specialized on these, so they are only checked here
+    if (metadata.na_action == NaAction::PASS) {
+        if (cumulative) {
+            run_numeric_worker<Worker<T, Wrapper, ArithMode<true, true, LOGICAL>>>(metadata, col_collection, wrapper, extras);
+        }
+        else {
+            run_numeric_worker<Worker<T, Wrapper, ArithMode<true, false, LOGICAL>>>(metadata, col_collection, wrapper, extras);
+        }
+    }
+    else {
+        if (cumulative) {
+            run_numeric_worker<Worker<T, Wrapper, ArithMode<false, true, LOGICAL>>>(metadata, col_collection, wrapper, extras);
+        }
+        else {
+            run_numeric_worker<Worker<T, Wrapper, ArithMode<false, false, LOGICAL>>>(metadata, col_collection, wrapper, extras);
+        }
+    }
 }
 
 // -------------------------------------------------------------------------------------------------
 
-template<template<typename> class Worker, template<int, typename> class Wrapper>
+template<template<typename, typename, typename> class Worker, template<int, typename> class Wrapper>
 void visit_into_numeric(const char* fun_name, const OperationMetadata& metadata, SEXP data, SEXP output, SEXP extras) {
     ColumnCollection col_collection = ColumnCollection::coerce(metadata, data);
     std::size_t out_len = output_length(metadata, col_collection);
 
     switch(metadata.output_mode) {
     case INTSXP:
-        visit_into_numeric<Worker<int>, Wrapper<INTSXP, int>>(metadata, col_collection, output, out_len, extras);
+        visit_into_numeric<Worker, int, Wrapper<INTSXP, int>, false>(metadata, col_collection, output, out_len, extras);
         break;
     case REALSXP:
-        visit_into_numeric<Worker<double>, Wrapper<REALSXP, double>>(metadata, col_collection, output, out_len, extras);
+        visit_into_numeric<Worker, double, Wrapper<REALSXP, double>, false>(metadata, col_collection, output, out_len, extras);
         break;
     case LGLSXP:
-        visit_into_numeric<Worker<int>, Wrapper<LGLSXP, int>>(metadata, col_collection, output, out_len, extras);
+        visit_into_numeric<Worker, int, Wrapper<LGLSXP, int>, true>(metadata, col_collection, output, out_len, extras);
         break;
     case CPLXSXP:
-        visit_into_numeric<Worker<std::complex<double>>, Wrapper<CPLXSXP, std::complex<double>>>(
+        visit_into_numeric<Worker, std::complex<double>, Wrapper<CPLXSXP, std::complex<double>>, false>(
                 metadata, col_collection, output, out_len, extras);
         break;
     default:
@@ -52,7 +81,7 @@ void visit_into_numeric(const char* fun_name, const OperationMetadata& metadata,
 
 // -------------------------------------------------------------------------------------------------
 
-template<template<typename> class Worker>
+template<template<typename, typename, typename> class Worker>
 SEXP visit_into_numeric(const char* fun_name, SEXP m, SEXP data, SEXP output, SEXP extras) {
     OperationMetadata metadata(m);
 
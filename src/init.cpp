@@ -15,6 +15,7 @@ static const R_CallMethodDef callMethods[] = {
     CALLDEF(row_infs, 4),
     CALLDEF(row_means, 4),
     CALLDEF(row_nas, 4),
+    CALLDEF(num_tasks, 3),
     {NULL, NULL, 0}
 };
 
@@ -1,8 +1,14 @@
 #ifndef WISEROW_UTILS_H_
 #define WISEROW_UTILS_H_
 
+#include "utils/ArithKernels.h"
 #include "utils/ArithUtils.h"
+#include "utils/BooleanKernels.h"
 #include "utils/BooleanUtils.h"
+#include "utils/ExtremaKernels.h"
+#include "utils/FlatSet.h"
+#include "utils/SimdUtils.h"
 #include "utils/StringUtils.h"
+#include "utils/TargetSet.h"
 
 #endif // WISEROW_UTILS_H_
@@ -0,0 +1,354 @@
+#include "ArithKernels.h"
+
+#include <cmath> // isnan
+
+#include <Rcpp.h> // NA_INTEGER
+
+#include "SimdUtils.h"
+
+namespace wiserow {
+
+namespace {
+
+// same as Rcpp's is_na, NaN counts as NA for doubles
+inline bool is_na_value(const double val) {
+    return std::isnan(val);
+}
+
+inline bool is_na_value(const int val) {
+    return val == NA_INTEGER;
+}
+
+// -------------------------------------------------------------------------------------------------
+
+template<typename T, typename U>
+void accumulate_scalar(const ArithOp op, const bool need_init, const bool pass_na,
+                       const U *values, const std::size_t begin, const std::size_t n,
+                       const Accumulators<T>& accumulators)
+{
+    const ArithmeticOperator arith_opr(op);
+
+    for (std::size_t r = begin; r < n; r++) {
+        unsigned char flags = accumulators.flags[r];
+        if (flags & ACC_NA_FOUND) continue;
+
+        const U val = values[r];
+        if (is_na_value(val)) {
+            if (pass_na) accumulators.flags[r] = flags | ACC_NA_FOUND;
+            continue;
+        }
+
+        const T x = val;
+        if (need_init && !(flags & ACC_INITIALIZED)) {
+            accumulators.acc[r] = x;
+        }
+        else {
+            accumulators.acc[r] = arith_opr.apply(accumulators.acc[r], x);
+        }
+
+        accumulators.flags[r] = flags | ACC_INITIALIZED;
+        accumulators.counts[r]++;
+    }
+}
+
+#ifdef WISEROW_X86_SIMD
+
+// -------------------------------------------------------------------------------------------------
+// bits of the lanes in [r, r + width) that have a flag set
+
+inline int flag_bits(const unsigned char *flags, const int width, const unsigned char flag) {
+    int bits = 0;
+    for (int k = 0; k < width; k++) {
+        bits |= ((flags[k] & flag) != 0) << k;
+    }
+    return bits;
+}
+
+// lane results back to the per-row state
+template<typename T>
+inline void scatter_bits(const int valid_bits, const int na_bits, const int width,
+                         const std::size_t r, const Accumulators<T>& accumulators)
+{
+    for (int k = 0; k < width; k++) {
+        int valid = (valid_bits >> k) & 1;
+        int na = (na_bits >> k) & 1;
+        accumulators.flags[r + k] |= (valid * ACC_INITIALIZED) | (na * ACC_NA_FOUND);
+        accumulators.counts[r + k] += valid;
+    }
+}
+
+// =================================================================================================
+// SSE2, 2 doubles per register
+
+inline __m128d load2(const double *values) {
+    return _mm_loadu_pd(values);
+}
+
+inline __m128d load2(const int *values) {
+    return _mm_cvtepi32_pd(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(values)));
+}
+
+inline __m128d na2(const __m128d val, const double *) {
+    return _mm_cmpunord_pd(val, val);
+}
+
+inline __m128d na2(const __m128d val, const int *) {
+    return _mm_cmpeq_pd(val, _mm_set1_pd(NA_INTEGER));
+}
+
+inline __m128d mask2(const int bits) {
+    return _mm_castsi128_pd(_mm_set_epi64x(-static_cast<long long>((bits >> 1) & 1),
+                                           -static_cast<long long>(bits & 1)));
+}
+
+// lanes of b where mask is set, otherwise lanes of a
+inline __m128d blend2(const __m128d a, const __m128d b, const __m128d mask) {
+    return _mm_or_pd(_mm_and_pd(mask, b), _mm_andnot_pd(mask, a));
+}
+
+template<ArithOp OP>
+inline __m128d apply2(const __m128d a, const __m128d b) {
+    switch(OP) {
+    case ArithOp::ADD:
+        return _mm_add_pd(a, b);
+    case ArithOp::SUB:
+        return _mm_sub_pd(a, b);
+    case ArithOp::MUL:
+        return _mm_mul_pd(a, b);
+    case ArithOp::DIV:
+        return _mm_div_pd(a, b);
+    }
+
+    return a; // nocov
+}
+
+template<ArithOp OP, typename U>
+void accumulate_sse2(const bool need_init, const bool pass_na,
+                     const U *values, const std::size_t n,
+                     const Accumulators<double>& accumulators)
+{
+    std::size_t r = 0;
+    for (; r + 2 <= n; r += 2) {
+        int dead_bits = flag_bits(accumulators.flags + r, 2, ACC_NA_FOUND);
+        __m128d val = load2(values + r);
+        __m128d acc = _mm_loadu_pd(accumulators.acc + r);
+        __m128d res = apply2<OP>(acc, val);
+
+        if (need_init) {
+            res = blend2(val, res, mask2(flag_bits(accumulators.flags + r, 2, ACC_INITIALIZED)));
+        }
+
+        int na_bits = _mm_movemask_pd(na2(val, values)) & ~dead_bits;
+        int valid_bits = ~(na_bits | dead_bits) & 0x3;
+
+        _mm_storeu_pd(accumulators.acc + r, blend2(acc, res, mask2(valid_bits)));
+        scatter_bits(valid_bits, pass_na ? na_bits : 0, 2, r, accumulators);
+    }
+
+    accumulate_scalar(OP, need_init, pass_na, values, r, n, accumulators);
+}
+
+// =================================================================================================
+// AVX2, 4 doubles or 8 ints per register
+
+WISEROW_TARGET_AVX2 inline __m256d load4(const double *values) {
+    return _mm256_loadu_pd(values);
+}
+
+WISEROW_TARGET_AVX2 inline __m256d load4(const int *values) {
+    return _mm256_cvtepi32_pd(_mm_loadu_si128(reinterpret_cast<const __m128i *>(values)));
+}
+
+WISEROW_TARGET_AVX2 inline __m256d na4(const __m256d val, const double *) {
+    return _mm256_cmp_pd(val, val, _CMP_UNORD_Q);
+}
+
+WISEROW_TARGET_AVX2 inline __m256d na4(const __m256d val, const int *) {
+    return _mm256_cmp_pd(val, _mm256_set1_pd(NA_INTEGER), _CMP_EQ_OQ);
+}
+
+WISEROW_TARGET_AVX2 inline __m256d mask4(const int bits) {
+    const __m256i lanes = _mm256_setr_epi64x(1, 2, 4, 8);
+    return _mm256_castsi256_pd(_mm256_cmpeq_epi64(_mm256_and_si256(_mm256_set1_epi64x(bits), lanes), lanes));
+}
+
+WISEROW_TARGET_AVX2 inline __m256i mask8(const int bits) {
+    const __m256i lanes = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    return _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(bits), lanes), lanes);
+}
+
+template<ArithOp OP>
+WISEROW_TARGET_AVX2 inline __m256d apply4(const __m256d a, const __m256d b) {
+    switch(OP) {
+    case ArithOp::ADD:
+        return _mm256_add_pd(a, b);
+    case ArithOp::SUB:
+        return _mm256_sub_pd(a, b);
+    case ArithOp::MUL:
+        return _mm256_mul_pd(a, b);
+    case ArithOp::DIV:
+        return _mm256_div_pd(a, b);
+    }
+
+    return a; // nocov
+}
+
+// integer division has no vector instruction, callers fall back to scalar code for it
+template<ArithOp OP>
+WISEROW_TARGET_AVX2 inline __m256i apply8(const __m256i a, const __m256i b) {
+    switch(OP) {
+    case ArithOp::ADD:
+        return _mm256_add_epi32(a, b);
+    case ArithOp::SUB:
+        return _mm256_sub_epi32(a, b);
+    case ArithOp::MUL:
+        return _mm256_mullo_epi32(a, b);
+    case ArithOp::DIV:
+        break; // nocov
+    }
+
+    return a; // nocov
+}
+
+template<ArithOp OP, typename U>
+WISEROW_TARGET_AVX2 void accumulate_avx2(const bool need_init, const bool pass_na,
+                                         const U *values, const std::size_t n,
+                                         const Accumulators<double>& accumulators)
+{
+    std::size_t r = 0;
+    for (; r + 4 <= n; r += 4) {
+        int dead_bits = flag_bits(accumulators.flags + r, 4, ACC_NA_FOUND);
+        __m256d val = load4(values + r);
+        __m256d acc = _mm256_loadu_pd(accumulators.acc + r);
+        __m256d res = apply4<OP>(acc, val);
+
+        if (need_init) {
+            res = _mm256_blendv_pd(val, res, mask4(flag_bits(accumulators.flags + r, 4, ACC_INITIALIZED)));
+        }
+
+        int na_bits = _mm256_movemask_pd(na4(val, values)) & ~dead_bits;
+        int valid_bits = ~(na_bits | dead_bits) & 0xF;
+
+        _mm256_storeu_pd(accumulators.acc + r, _mm256_blendv_pd(acc, res, mask4(valid_bits)));
+        scatter_bits(valid_bits, pass_na ? na_bits : 0, 4, r, accumulators);
+    }
+
+    accumulate_scalar(OP, need_init, pass_na, values, r, n, accumulators);
+}
+
+template<ArithOp OP>
+WISEROW_TARGET_AVX2 void accumulate_avx2(const bool need_init, const bool pass_na,
+                                         const int *values, const std::size_t n,
+                                         const Accumulators<int>& accumulators)
+{
+    const __m256i na_integer = _mm256_set1_epi32(NA_INTEGER);
+
+    std::size_t r = 0;
+    for (; r + 8 <= n; r += 8) {
+        int dead_bits = flag_bits(accumulators.flags + r, 8, ACC_NA_FOUND);
+        __m256i val = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(values + r));
+        __m256i acc = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(accumulators.acc + r));
+        __m256i res = apply8<OP>(acc, val);
+
+        if (need_init) {
+            res = _mm256_blendv_epi8(val, res, mask8(flag_bits(accumulators.flags + r, 8, ACC_INITIALIZED)));
+        }
+
+        __m256i na = _mm256_cmpeq_epi32(val, na_integer);
+        int na_bits = _mm256_movemask_ps(_mm256_castsi256_ps(na)) & ~dead_bits;
+        int valid_bits = ~(na_bits | dead_bits) & 0xFF;
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(accumulators.acc + r), _mm256_blendv_epi8(acc, res, mask8(valid_bits)));
+        scatter_bits(valid_bits, pass_na ? na_bits : 0, 8, r, accumulators);
+    }
+
+    accumulate_scalar(OP, need_init, pass_na, values, r, n, accumulators);
+}
+
+#endif // WISEROW_X86_SIMD
+
+// =================================================================================================
+
+template<typename U>
+void accumulate_doubles(const ArithOp op, const bool need_init, const bool pass_na,
+                        const U *values, const std::size_t n, const Accumulators<double>& accumulators)
+{
+#ifdef WISEROW_X86_SIMD
+    switch(simd_level()) {
+    case SimdLevel::AVX2: {
+        switch(op) {
+        case ArithOp::ADD: return accumulate_avx2<ArithOp::ADD>(need_init, pass_na, values, n, accumulators);
+        case ArithOp::SUB: return accumulate_avx2<ArithOp::SUB>(need_init, pass_na, values, n, accumulators);
+        case ArithOp::MUL: return accumulate_avx2<ArithOp::MUL>(need_init, pass_na, values, n, accumulators);
+        case ArithOp::DIV: return accumulate_avx2<ArithOp::DIV>(need_init, pass_na, values, n, accumulators);
+        }
+
+        break; // nocov
+    }
+    case SimdLevel::SSE2: {
+        switch(op) {
+        case ArithOp::ADD: return accumulate_sse2<ArithOp::ADD>(need_init, pass_na, values, n, accumulators);
+        case ArithOp::SUB: return accumulate_sse2<ArithOp::SUB>(need_init, pass_na, values, n, accumulators);
+        case ArithOp::MUL: return accumulate_sse2<ArithOp::MUL>(need_init, pass_na, values, n, accumulators);
+        case ArithOp::DIV: return accumulate_sse2<ArithOp::DIV>(need_init, pass_na, values, n, accumulators);
+        }
+
+        break; // nocov
+    }
+    case SimdLevel::SCALAR: {
+        break;
+    }
+    }
+#endif
+
+    accumulate_scalar(op, need_init, pass_na, values, 0, n, accumulators);
+}
+
+} // anonymous namespace
+
+// =================================================================================================
+
+bool accumulate_contiguous(const ArithOp op, const bool need_init, const bool pass_na,
+                           const double *values, const std::size_t n, const Accumulators<double>& accumulators)
+{
+    accumulate_doubles(op, need_init, pass_na, values, n, accumulators);
+    return true;
+}
+
+// -------------------------------------------------------------------------------------------------
+
+bool accumulate_contiguous(const ArithOp op, const bool need_init, const bool pass_na,
+                           const int *values, const std::size_t n, const Accumulators<double>& accumulators)
+{
+    accumulate_doubles(op, need_init, pass_na, values, n, accumulators);
+    return true;
+}
+
+// -------------------------------------------------------------------------------------------------
+
+bool accumulate_contiguous(const ArithOp op, const bool need_init, const bool pass_na,
+                           const int *values, const std::size_t n, const Accumulators<int>& accumulators)
+{
+#ifdef WISEROW_X86_SIMD
+    if (simd_level() == SimdLevel::AVX2) {
+        switch(op) {
+        case ArithOp::ADD:
+            accumulate_avx2<ArithOp::ADD>(need_init, pass_na, values, n, accumulators);
+            return true;
+        case ArithOp::SUB:
+            accumulate_avx2<ArithOp::SUB>(need_init, pass_na, values, n, accumulators);
+            return true;
+        case ArithOp::MUL:
+            accumulate_avx2<ArithOp::MUL>(need_init, pass_na, values, n, accumulators);
+            return true;
+        case ArithOp::DIV:
+            break;
+        }
+    }
+#endif
+
+    accumulate_scalar(op, need_init, pass_na, values, 0, n, accumulators);
+    return true;
+}
+
+} // namespace wiserow
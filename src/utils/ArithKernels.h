@@ -0,0 +1,49 @@
+#ifndef WISEROW_ARITHKERNELS_H_
+#define WISEROW_ARITHKERNELS_H_
+
+#include <cstddef> // size_t
+
+#include "ArithUtils.h"
+
+namespace wiserow {
+
+// per-row flags of accumulators in column-at-a-time mode
+enum AccumulatorFlag : unsigned char {
+    ACC_INITIALIZED = 1, // at least one non-NA value was accumulated
+    ACC_NA_FOUND = 2,    // NA found and na_action = pass, the accumulator is done
+    ACC_STOPPED = 4      // free for callers
+};
+
+template<typename T>
+struct Accumulators
+{
+    T *acc;
+    int *counts;
+    unsigned char *flags;
+};
+
+/*
+ * Accumulate n contiguous values into n accumulators with vectorized kernels if the CPU allows.
+ * NA values are skipped, or mark the accumulator with ACC_NA_FOUND if pass_na.
+ * The first non-NA value replaces the accumulator if need_init.
+ * NA detection is done with masks, so there are no per-element branches.
+ *
+ * Returns false if there is no kernel for the given types, in which case nothing is done.
+ */
+bool accumulate_contiguous(const ArithOp op, const bool need_init, const bool pass_na,
+                           const double *values, const std::size_t n, const Accumulators<double>& accumulators);
+
+bool accumulate_contiguous(const ArithOp op, const bool need_init, const bool pass_na,
+                           const int *values, const std::size_t n, const Accumulators<double>& accumulators);
+
+bool accumulate_contiguous(const ArithOp op, const bool need_init, const bool pass_na,
+                           const int *values, const std::size_t n, const Accumulators<int>& accumulators);
+
+template<typename U, typename T>
+bool accumulate_contiguous(const ArithOp, const bool, const bool, const U *, const std::size_t, const Accumulators<T>&) {
+    return false;
+}
+
+} // namespace wiserow
+
+#endif // WISEROW_ARITHKERNELS_H_
@@ -0,0 +1,236 @@
+#include "BooleanKernels.h"
+
+#include <cstdint>
+#include <cstring> // memcpy, memset
+
+#include <Rcpp.h> // NA_INTEGER
+
+#include "SimdUtils.h"
+
+namespace wiserow {
+
+namespace {
+
+// sign bit cleared
+const std::uint64_t ABS_MASK = 0x7FFFFFFFFFFFFFFFULL;
+// exponent all ones and zero mantissa, anything above is NaN (including R's NA)
+const std::uint64_t INF_BITS = 0x7FF0000000000000ULL;
+
+// na and inf bits of width lanes to 0/1 matches
+inline int match_bits(const ValueTest test, const int na_bits, const int inf_bits, const int width) {
+    switch(test) {
+    case ValueTest::IS_NA:
+        return na_bits;
+    case ValueTest::IS_INF:
+        return inf_bits;
+    case ValueTest::IS_FINITE:
+        return ~(na_bits | inf_bits) & ((1 << width) - 1);
+    }
+
+    return 0; // nocov
+}
+
+inline void write_bits(const int bits, const int width, unsigned char *matches) {
+    for (int k = 0; k < width; k++) {
+        matches[k] = (bits >> k) & 1;
+    }
+}
+
+// complex values take 2 lanes, the real part in the lower one
+inline int complex_bits(const ValueTest test, const int na_bits, const int inf_bits, const int width) {
+    int bits = 0;
+    for (int k = 0; k < width; k++) {
+        int na = ((na_bits >> (2 * k)) | (na_bits >> (2 * k + 1))) & 1;
+        int inf = ((inf_bits >> (2 * k)) | (inf_bits >> (2 * k + 1))) & 1;
+        bits |= match_bits(test, na, inf & ~na, 1) << k;
+    }
+    return bits;
+}
+
+// -------------------------------------------------------------------------------------------------
+
+inline void classify_scalar(const double val, int& na_bit, int& inf_bit) {
+    std::uint64_t bits;
+    std::memcpy(&bits, &val, sizeof(double));
+    bits &= ABS_MASK;
+
+    na_bit = bits > INF_BITS;
+    inf_bit = bits == INF_BITS;
+}
+
+void test_scalar(const ValueTest test, const int *values, const std::size_t begin, const std::size_t n, unsigned char *matches) {
+    for (std::size_t r = begin; r < n; r++) {
+        int na = values[r] == NA_INTEGER;
+        matches[r] = match_bits(test, na, 0, 1);
+    }
+}
+
+void test_scalar(const ValueTest test, const double *values, const std::size_t begin, const std::size_t n, unsigned char *matches) {
+    int na, inf;
+    for (std::size_t r = begin; r < n; r++) {
+        classify_scalar(values[r], na, inf);
+        matches[r] = match_bits(test, na, inf, 1);
+    }
+}
+
+void test_scalar(const ValueTest test, const std::complex<double> *values, const std::size_t begin, const std::size_t n, unsigned char *matches) {
+    int na_re, inf_re, na_im, inf_im;
+    for (std::size_t r = begin; r < n; r++) {
+        classify_scalar(values[r].real(), na_re, inf_re);
+        classify_scalar(values[r].imag(), na_im, inf_im);
+        matches[r] = complex_bits(test, na_re | (na_im << 1), inf_re | (inf_im << 1), 1);
+    }
+}
+
+#ifdef WISEROW_X86_SIMD
+
+// =================================================================================================
+// SSE2 has no 64 bit integer compares, so doubles are classified with unordered/ordered compares of their magnitude
+
+inline void classify2(const double *values, int& na_bits, int& inf_bits) {
+    const __m128d abs_mask = _mm_castsi128_pd(_mm_set1_epi64x(ABS_MASK));
+    const __m128d inf = _mm_castsi128_pd(_mm_set1_epi64x(INF_BITS));
+
+    __m128d val = _mm_loadu_pd(values);
+    na_bits = _mm_movemask_pd(_mm_cmpunord_pd(val, val));
+    inf_bits = _mm_movemask_pd(_mm_cmpeq_pd(_mm_and_pd(val, abs_mask), inf));
+}
+
+void test_sse2(const ValueTest test, const int *values, const std::size_t n, unsigned char *matches) {
+    const __m128i na_integer = _mm_set1_epi32(NA_INTEGER);
+
+    std::size_t r = 0;
+    for (; r + 4 <= n; r += 4) {
+        __m128i val = _mm_loadu_si128(reinterpret_cast<const __m128i *>(values + r));
+        int na_bits = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(val, na_integer)));
+        write_bits(match_bits(test, na_bits, 0, 4), 4, matches + r);
+    }
+
+    test_scalar(test, values, r, n, matches);
+}
+
+void test_sse2(const ValueTest test, const double *values, const std::size_t n, unsigned char *matches) {
+    int na_bits, inf_bits;
+
+    std::size_t r = 0;
+    for (; r + 2 <= n; r += 2) {
+        classify2(values + r, na_bits, inf_bits);
+        write_bits(match_bits(test, na_bits, inf_bits, 2), 2, matches + r);
+    }
+
+    test_scalar(test, values, r, n, matches);
+}
+
+void test_sse2(const ValueTest test, const std::complex<double> *values, const std::size_t n, unsigned char *matches) {
+    int na_bits, inf_bits;
+
+    for (std::size_t r = 0; r < n; r++) {
+        classify2(reinterpret_cast<const double *>(values + r), na_bits, inf_bits);
+        matches[r] = complex_bits(test, na_bits, inf_bits, 1);
+    }
+}
+
+// =================================================================================================
+// AVX2, doubles are classified based on their bit patterns
+
+WISEROW_TARGET_AVX2 inline void classify4(const double *values, int& na_bits, int& inf_bits) {
+    const __m256i abs_mask = _mm256_set1_epi64x(ABS_MASK);
+    const __m256i inf = _mm256_set1_epi64x(INF_BITS);
+
+    // the magnitude is non-negative as a signed integer, so a signed compare is fine
+    __m256i bits = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(values)), abs_mask);
+    na_bits = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(bits, inf)));
+    inf_bits = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(bits, inf)));
+}
+
+WISEROW_TARGET_AVX2 void test_avx2(const ValueTest test, const int *values, const std::size_t n, unsigned char *matches) {
+    const __m256i na_integer = _mm256_set1_epi32(NA_INTEGER);
+
+    std::size_t r = 0;
+    for (; r + 8 <= n; r += 8) {
+        __m256i val = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(values + r));
+        int na_bits = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(val, na_integer)));
+        write_bits(match_bits(test, na_bits, 0, 8), 8, matches + r);
+    }
+
+    test_scalar(test, values, r, n, matches);
+}
+
+WISEROW_TARGET_AVX2 void test_avx2(const ValueTest test, const double *values, const std::size_t n, unsigned char *matches) {
+    int na_bits, inf_bits;
+
+    std::size_t r = 0;
+    for (; r + 4 <= n; r += 4) {
+        classify4(values + r, na_bits, inf_bits);
+        write_bits(match_bits(test, na_bits, inf_bits, 4), 4, matches + r);
+    }
+
+    test_scalar(test, values, r, n, matches);
+}
+
+WISEROW_TARGET_AVX2 void test_avx2(const ValueTest test, const std::complex<double> *values, const std::size_t n, unsigned char *matches) {
+    int na_bits, inf_bits;
+
+    std::size_t r = 0;
+    for (; r + 2 <= n; r += 2) {
+        classify4(reinterpret_cast<const double *>(values + r), na_bits, inf_bits);
+        write_bits(complex_bits(test, na_bits, inf_bits, 2), 2, matches + r);
+    }
+
+    test_scalar(test, values, r, n, matches);
+}
+
+#endif // WISEROW_X86_SIMD
+
+// -------------------------------------------------------------------------------------------------
+
+template<typename T>
+void test_dispatch(const ValueTest test, const T *values, const std::size_t n, unsigned char *matches) {
+#ifdef WISEROW_X86_SIMD
+    switch(simd_level()) {
+    case SimdLevel::AVX2: {
+        test_avx2(test, values, n, matches);
+        return;
+    }
+    case SimdLevel::SSE2: {
+        test_sse2(test, values, n, matches);
+        return;
+    }
+    case SimdLevel::SCALAR: {
+        break;
+    }
+    }
+#endif
+
+    test_scalar(test, values, 0, n, matches);
+}
+
+} // anonymous namespace
+
+// =================================================================================================
+
+bool test_contiguous(const ValueTest test, const int *values, const std::size_t n, unsigned char *matches) {
+    if (test == ValueTest::IS_INF) {
+        std::memset(matches, 0, n); // integers are never infinite
+        return true;
+    }
+
+    test_dispatch(test, values, n, matches);
+    return true;
+}
+
+// -------------------------------------------------------------------------------------------------
+
+bool test_contiguous(const ValueTest test, const double *values, const std::size_t n, unsigned char *matches) {
+    test_dispatch(test, values, n, matches);
+    return true;
+}
+
+// -------------------------------------------------------------------------------------------------
+
+bool test_contiguous(const ValueTest test, const std::complex<double> *values, const std::size_t n, unsigned char *matches) {
+    test_dispatch(test, values, n, matches);
+    return true;
+}
+
+} // namespace wiserow
@@ -0,0 +1,35 @@
+#ifndef WISEROW_BOOLEANKERNELS_H_
+#define WISEROW_BOOLEANKERNELS_H_
+
+#include <complex>
+#include <cstddef> // size_t
+
+namespace wiserow {
+
+// the value checks behind row_nas, row_infs and row_finites
+enum class ValueTest {
+    IS_NA,      // NA or NaN
+    IS_INF,     // +/- Inf
+    IS_FINITE   // neither NA nor infinite
+};
+
+/*
+ * Test n contiguous values, writing 1 or 0 to matches.
+ * Doubles are checked based on their bit patterns, integers (and logicals) against NA_INTEGER,
+ * using vectorized kernels if the CPU allows.
+ * Complex numbers are NA if any part is, infinite if none is NA and any is infinite.
+ *
+ * Returns false if there is no kernel for the given type, in which case nothing is done.
+ */
+bool test_contiguous(const ValueTest test, const int *values, const std::size_t n, unsigned char *matches);
+bool test_contiguous(const ValueTest test, const double *values, const std::size_t n, unsigned char *matches);
+bool test_contiguous(const ValueTest test, const std::complex<double> *values, const std::size_t n, unsigned char *matches);
+
+template<typename T>
+bool test_contiguous(const ValueTest, const T *, const std::size_t, unsigned char *) {
+    return false;
+}
+
+} // namespace wiserow
+
+#endif // WISEROW_BOOLEANKERNELS_H_
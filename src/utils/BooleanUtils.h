@@ -76,44 +76,15 @@ public:
 
     bool apply(const boost::string_ref& a, const boost::string_ref& b) const;
 
+    // numbers are compared as R would print them
     template<typename T>
     bool apply(const boost::string_ref& a, const T& b) const {
-        switch(comp_op_) {
-        case CompOp::EQ:
-            return a == ::wiserow::to_string(b);
-        case CompOp::NEQ:
-            return a != ::wiserow::to_string(b);
-        case CompOp::LT:
-            return a < ::wiserow::to_string(b);
-        case CompOp::LTE:
-            return a <= ::wiserow::to_string(b);
-        case CompOp::GT:
-            return a > ::wiserow::to_string(b);
-        case CompOp::GTE:
-            return a >= ::wiserow::to_string(b);
-        }
-
-        return false; // nocov
+        return apply(a, NumberString(b).str());
     }
 
     template<typename T>
     bool apply(const T& a, const boost::string_ref& b) const {
-        switch(comp_op_) {
-        case CompOp::EQ:
-            return ::wiserow::to_string(a) == b;
-        case CompOp::NEQ:
-            return ::wiserow::to_string(a) != b;
-        case CompOp::LT:
-            return ::wiserow::to_string(a) < b;
-        case CompOp::LTE:
-            return ::wiserow::to_string(a) <= b;
-        case CompOp::GT:
-            return ::wiserow::to_string(a) > b;
-        case CompOp::GTE:
-            return ::wiserow::to_string(a) >= b;
-        }
-
-        return false; // nocov
+        return apply(NumberString(a).str(), b);
     }
 
     bool apply(const std::complex<double>& a, const std::complex<double>& b) const;
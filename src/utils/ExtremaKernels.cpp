@@ -0,0 +1,366 @@
+#include "ExtremaKernels.h"
+
+#include <cmath> // isnan
+
+#include <Rcpp.h> // NA_INTEGER
+
+#include "SimdUtils.h"
+
+namespace wiserow {
+
+namespace {
+
+// same as Rcpp's is_na, NaN counts as NA for doubles
+inline bool is_missing(const double val) {
+    return std::isnan(val);
+}
+
+inline bool is_missing(const int val) {
+    return val == NA_INTEGER;
+}
+
+template<typename T>
+inline bool replaces(const CompOp comp_op, const T val, const T extremum) {
+    switch(comp_op) {
+    case CompOp::LT:
+        return val < extremum;
+    case CompOp::LTE:
+        return val <= extremum;
+    case CompOp::GT:
+        return val > extremum;
+    case CompOp::GTE:
+        return val >= extremum;
+    case CompOp::EQ:
+    case CompOp::NEQ:
+        break; // nocov
+    }
+
+    return false; // nocov
+}
+
+// == and != are accepted by row_extrema but make no sense as extrema, they use the generic code
+inline bool has_kernel(const CompOp comp_op) {
+    return comp_op != CompOp::EQ && comp_op != CompOp::NEQ;
+}
+
+template<typename T>
+inline bool has_kernel(const Extrema<T>& first, const Extrema<T> *second) {
+    return has_kernel(first.comp_op) && (!second || has_kernel(second->comp_op));
+}
+
+// -------------------------------------------------------------------------------------------------
+
+template<typename T, typename U>
+void extrema_scalar(const bool pass_na, const int which,
+                    const U *values, const std::size_t begin, const std::size_t n,
+                    const Extrema<T>& extrema)
+{
+    for (std::size_t r = begin; r < n; r++) {
+        unsigned char flags = extrema.flags[r];
+        if (flags & EXTREMUM_NA) continue;
+
+        const U val = values[r];
+        if (is_missing(val)) {
+            if (pass_na) extrema.flags[r] = flags | EXTREMUM_NA;
+            continue;
+        }
+
+        const T x = val;
+        if (!(flags & EXTREMUM_FOUND) || replaces(extrema.comp_op, x, extrema.values[r])) {
+            extrema.values[r] = x;
+            extrema.which[r] = which;
+            extrema.flags[r] = flags | EXTREMUM_FOUND;
+        }
+    }
+}
+
+template<typename T, typename U>
+void extrema_scalar(const bool pass_na, const int which,
+                    const U *values, const std::size_t begin, const std::size_t n,
+                    const Extrema<T>& first, const Extrema<T> *second)
+{
+    extrema_scalar(pass_na, which, values, begin, n, first);
+    if (second) extrema_scalar(pass_na, which, values, begin, n, *second);
+}
+
+#ifdef WISEROW_X86_SIMD
+
+// -------------------------------------------------------------------------------------------------
+// bits of the lanes in [r, r + width) whose extremum has been found
+
+inline int found_bits(const unsigned char *flags, const int width) {
+    int bits = 0;
+    for (int k = 0; k < width; k++) {
+        bits |= (flags[k] & EXTREMUM_FOUND) << k;
+    }
+    return bits;
+}
+
+// the lanes where the value was taken, and NA lanes if pass_na; rows that were already NA don't matter
+template<typename T>
+inline void update_lanes(const int taken_bits, const int na_bits, const int width, const int which,
+                         const std::size_t r, const Extrema<T>& extrema)
+{
+    for (int k = 0; k < width; k++) {
+        int taken = (taken_bits >> k) & 1;
+        int na = (na_bits >> k) & 1;
+        extrema.which[r + k] = taken ? which : extrema.which[r + k];
+        extrema.flags[r + k] |= (taken * EXTREMUM_FOUND) | (na * EXTREMUM_NA);
+    }
+}
+
+// =================================================================================================
+// SSE2, 2 doubles per register
+
+inline __m128d cells2(const double *values) {
+    return _mm_loadu_pd(values);
+}
+
+inline __m128d cells2(const int *values) {
+    return _mm_cvtepi32_pd(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(values)));
+}
+
+inline __m128d missing2(const __m128d val, const double *) {
+    return _mm_cmpunord_pd(val, val);
+}
+
+inline __m128d missing2(const __m128d val, const int *) {
+    return _mm_cmpeq_pd(val, _mm_set1_pd(NA_INTEGER));
+}
+
+// NaN lanes compare false, but they are never taken anyway
+inline int replaces2(const CompOp comp_op, const __m128d val, const __m128d extremum) {
+    switch(comp_op) {
+    case CompOp::LT:
+        return _mm_movemask_pd(_mm_cmplt_pd(val, extremum));
+    case CompOp::LTE:
+        return _mm_movemask_pd(_mm_cmple_pd(val, extremum));
+    case CompOp::GT:
+        return _mm_movemask_pd(_mm_cmpgt_pd(val, extremum));
+    case CompOp::GTE:
+        return _mm_movemask_pd(_mm_cmpge_pd(val, extremum));
+    case CompOp::EQ:
+    case CompOp::NEQ:
+        break; // nocov
+    }
+
+    return 0; // nocov
+}
+
+inline void update2(const bool pass_na, const int which, const __m128d val, const int na_bits,
+                    const std::size_t r, const Extrema<double>& extrema)
+{
+    __m128d extremum = _mm_loadu_pd(extrema.values + r);
+    int taken_bits = (replaces2(extrema.comp_op, val, extremum) | ~found_bits(extrema.flags + r, 2)) & ~na_bits & 0x3;
+
+    __m128d mask = _mm_castsi128_pd(_mm_set_epi64x(-static_cast<long long>((taken_bits >> 1) & 1),
+                                                   -static_cast<long long>(taken_bits & 1)));
+
+    _mm_storeu_pd(extrema.values + r, _mm_or_pd(_mm_and_pd(mask, val), _mm_andnot_pd(mask, extremum)));
+    update_lanes(taken_bits, pass_na ? na_bits : 0, 2, which, r, extrema);
+}
+
+template<typename U>
+void extrema_sse2(const bool pass_na, const int which, const U *values, const std::size_t n,
+                  const Extrema<double>& first, const Extrema<double> *second)
+{
+    std::size_t r = 0;
+    for (; r + 2 <= n; r += 2) {
+        __m128d val = cells2(values + r);
+        int na_bits = _mm_movemask_pd(missing2(val, values));
+
+        update2(pass_na, which, val, na_bits, r, first);
+        if (second) update2(pass_na, which, val, na_bits, r, *second);
+    }
+
+    extrema_scalar(pass_na, which, values, r, n, first, second);
+}
+
+// =================================================================================================
+// AVX2, 4 doubles or 8 ints per register
+
+WISEROW_TARGET_AVX2 inline __m256d cells4(const double *values) {
+    return _mm256_loadu_pd(values);
+}
+
+WISEROW_TARGET_AVX2 inline __m256d cells4(const int *values) {
+    return _mm256_cvtepi32_pd(_mm_loadu_si128(reinterpret_cast<const __m128i *>(values)));
+}
+
+WISEROW_TARGET_AVX2 inline __m256d missing4(const __m256d val, const double *) {
+    return _mm256_cmp_pd(val, val, _CMP_UNORD_Q);
+}
+
+WISEROW_TARGET_AVX2 inline __m256d missing4(const __m256d val, const int *) {
+    return _mm256_cmp_pd(val, _mm256_set1_pd(NA_INTEGER), _CMP_EQ_OQ);
+}
+
+WISEROW_TARGET_AVX2 inline int replaces4(const CompOp comp_op, const __m256d val, const __m256d extremum) {
+    switch(comp_op) {
+    case CompOp::LT:
+        return _mm256_movemask_pd(_mm256_cmp_pd(val, extremum, _CMP_LT_OQ));
+    case CompOp::LTE:
+        return _mm256_movemask_pd(_mm256_cmp_pd(val, extremum, _CMP_LE_OQ));
+    case CompOp::GT:
+        return _mm256_movemask_pd(_mm256_cmp_pd(val, extremum, _CMP_GT_OQ));
+    case CompOp::GTE:
+        return _mm256_movemask_pd(_mm256_cmp_pd(val, extremum, _CMP_GE_OQ));
+    case CompOp::EQ:
+    case CompOp::NEQ:
+        break; // nocov
+    }
+
+    return 0; // nocov
+}
+
+// integers only have >, the other comparisons swap or negate it
+WISEROW_TARGET_AVX2 inline int replaces8(const CompOp comp_op, const __m256i val, const __m256i extremum) {
+    __m256i mask;
+    switch(comp_op) {
+    case CompOp::LT:
+        mask = _mm256_cmpgt_epi32(extremum, val);
+        break;
+    case CompOp::LTE:
+        mask = _mm256_xor_si256(_mm256_cmpgt_epi32(val, extremum), _mm256_set1_epi32(-1));
+        break;
+    case CompOp::GT:
+        mask = _mm256_cmpgt_epi32(val, extremum);
+        break;
+    case CompOp::GTE:
+        mask = _mm256_xor_si256(_mm256_cmpgt_epi32(extremum, val), _mm256_set1_epi32(-1));
+        break;
+    default:
+        return 0; // nocov
+    }
+
+    return _mm256_movemask_ps(_mm256_castsi256_ps(mask));
+}
+
+WISEROW_TARGET_AVX2 inline void update4(const bool pass_na, const int which, const __m256d val, const int na_bits,
+                                        const std::size_t r, const Extrema<double>& extrema)
+{
+    const __m256i lanes = _mm256_setr_epi64x(1, 2, 4, 8);
+
+    __m256d extremum = _mm256_loadu_pd(extrema.values + r);
+    int taken_bits = (replaces4(extrema.comp_op, val, extremum) | ~found_bits(extrema.flags + r, 4)) & ~na_bits & 0xF;
+
+    __m256i taken = _mm256_and_si256(_mm256_set1_epi64x(taken_bits), lanes);
+    __m256d mask = _mm256_castsi256_pd(_mm256_cmpeq_epi64(taken, lanes));
+
+    _mm256_storeu_pd(extrema.values + r, _mm256_blendv_pd(extremum, val, mask));
+    update_lanes(taken_bits, pass_na ? na_bits : 0, 4, which, r, extrema);
+}
+
+WISEROW_TARGET_AVX2 inline void update8(const bool pass_na, const int which, const __m256i val, const int na_bits,
+                                        const std::size_t r, const Extrema<int>& extrema)
+{
+    const __m256i lanes = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+
+    __m256i *ptr = reinterpret_cast<__m256i *>(extrema.values + r);
+    __m256i extremum = _mm256_loadu_si256(ptr);
+    int taken_bits = (replaces8(extrema.comp_op, val, extremum) | ~found_bits(extrema.flags + r, 8)) & ~na_bits & 0xFF;
+
+    __m256i mask = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(taken_bits), lanes), lanes);
+
+    _mm256_storeu_si256(ptr, _mm256_blendv_epi8(extremum, val, mask));
+    update_lanes(taken_bits, pass_na ? na_bits : 0, 8, which, r, extrema);
+}
+
+template<typename U>
+WISEROW_TARGET_AVX2 void extrema_avx2(const bool pass_na, const int which, const U *values, const std::size_t n,
+                                      const Extrema<double>& first, const Extrema<double> *second)
+{
+    std::size_t r = 0;
+    for (; r + 4 <= n; r += 4) {
+        __m256d val = cells4(values + r);
+        int na_bits = _mm256_movemask_pd(missing4(val, values));
+
+        update4(pass_na, which, val, na_bits, r, first);
+        if (second) update4(pass_na, which, val, na_bits, r, *second);
+    }
+
+    extrema_scalar(pass_na, which, values, r, n, first, second);
+}
+
+WISEROW_TARGET_AVX2 void extrema_avx2(const bool pass_na, const int which, const int *values, const std::size_t n,
+                                      const Extrema<int>& first, const Extrema<int> *second)
+{
+    const __m256i na_integer = _mm256_set1_epi32(NA_INTEGER);
+
+    std::size_t r = 0;
+    for (; r + 8 <= n; r += 8) {
+        __m256i val = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(values + r));
+        int na_bits = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(val, na_integer)));
+
+        update8(pass_na, which, val, na_bits, r, first);
+        if (second) update8(pass_na, which, val, na_bits, r, *second);
+    }
+
+    extrema_scalar(pass_na, which, values, r, n, first, second);
+}
+
+#endif // WISEROW_X86_SIMD
+
+// =================================================================================================
+
+template<typename U>
+void extrema_doubles(const bool pass_na, const int which, const U *values, const std::size_t n,
+                     const Extrema<double>& first, const Extrema<double> *second)
+{
+#ifdef WISEROW_X86_SIMD
+    switch(simd_level()) {
+    case SimdLevel::AVX2:
+        return extrema_avx2(pass_na, which, values, n, first, second);
+    case SimdLevel::SSE2:
+        return extrema_sse2(pass_na, which, values, n, first, second);
+    case SimdLevel::SCALAR:
+        break;
+    }
+#endif
+
+    extrema_scalar(pass_na, which, values, 0, n, first, second);
+}
+
+} // anonymous namespace
+
+// =================================================================================================
+
+bool extrema_contiguous(const bool pass_na, const int which, const double *values, const std::size_t n,
+                        const Extrema<double>& first, const Extrema<double> *second)
+{
+    if (!has_kernel(first, second)) return false;
+
+    extrema_doubles(pass_na, which, values, n, first, second);
+    return true;
+}
+
+// -------------------------------------------------------------------------------------------------
+
+bool extrema_contiguous(const bool pass_na, const int which, const int *values, const std::size_t n,
+                        const Extrema<double>& first, const Extrema<double> *second)
+{
+    if (!has_kernel(first, second)) return false;
+
+    extrema_doubles(pass_na, which, values, n, first, second);
+    return true;
+}
+
+// -------------------------------------------------------------------------------------------------
+
+bool extrema_contiguous(const bool pass_na, const int which, const int *values, const std::size_t n,
+                        const Extrema<int>& first, const Extrema<int> *second)
+{
+    if (!has_kernel(first, second)) return false;
+
+#ifdef WISEROW_X86_SIMD
+    if (simd_level() == SimdLevel::AVX2) {
+        extrema_avx2(pass_na, which, values, n, first, second);
+        return true;
+    }
+#endif
+
+    extrema_scalar(pass_na, which, values, 0, n, first, second);
+    return true;
+}
+
+} // namespace wiserow
@@ -0,0 +1,50 @@
+#ifndef WISEROW_EXTREMAKERNELS_H_
+#define WISEROW_EXTREMAKERNELS_H_
+
+#include <cstddef> // size_t
+
+#include "BooleanUtils.h"
+
+namespace wiserow {
+
+// per-row flags of extrema in column-at-a-time mode
+enum ExtremumFlag : unsigned char {
+    EXTREMUM_FOUND = 1, // at least one non-NA value was seen
+    EXTREMUM_NA = 2     // NA found and na_action = pass, the extremum is done
+};
+
+template<typename T>
+struct Extrema
+{
+    CompOp comp_op; // a value replaces the extremum if comp_op(value, extremum)
+    T *values;
+    int *which;
+    unsigned char *flags;
+};
+
+/*
+ * Update n extrema with n contiguous values from the column with (1-based) index which,
+ * using vectorized kernels if the CPU allows.
+ * The first non-NA value of each row is always taken, so ties keep the first occurrence for < and >.
+ * NA values are skipped, or mark the extremum with EXTREMUM_NA if pass_na.
+ * If second is not null, it is updated with the same loaded values, e.g. for minima and maxima together.
+ *
+ * Returns false if there is no kernel for the given types or operators, in which case nothing is done.
+ */
+bool extrema_contiguous(const bool pass_na, const int which, const double *values, const std::size_t n,
+                        const Extrema<double>& first, const Extrema<double> *second);
+
+bool extrema_contiguous(const bool pass_na, const int which, const int *values, const std::size_t n,
+                        const Extrema<double>& first, const Extrema<double> *second);
+
+bool extrema_contiguous(const bool pass_na, const int which, const int *values, const std::size_t n,
+                        const Extrema<int>& first, const Extrema<int> *second);
+
+template<typename U, typename T>
+bool extrema_contiguous(const bool, const int, const U *, const std::size_t, const Extrema<T>&, const Extrema<T> *) {
+    return false;
+}
+
+} // namespace wiserow
+
+#endif // WISEROW_EXTREMAKERNELS_H_
@@ -0,0 +1,203 @@
+#ifndef WISEROW_FLATSET_H_
+#define WISEROW_FLATSET_H_
+
+#include <complex>
+#include <cstddef> // size_t
+#include <cstdint>
+#include <cstring> // memcpy
+#include <vector>
+
+namespace wiserow {
+
+inline std::size_t mix_bits(std::uint64_t bits) {
+    bits ^= bits >> 33;
+    bits *= 0xFF51AFD7ED558CCDULL;
+    bits ^= bits >> 33;
+    bits *= 0xC4CEB9FE1A85EC53ULL;
+    bits ^= bits >> 33;
+    return static_cast<std::size_t>(bits);
+}
+
+// 0 and -0 compare equal, so they must hash the same
+inline std::uint64_t double_bits(const double val) {
+    double normalized = val == 0 ? 0.0 : val;
+    std::uint64_t bits;
+    std::memcpy(&bits, &normalized, sizeof(double));
+    return bits;
+}
+
+// FNV-1a
+inline std::size_t hash_bytes(const char *str, const std::size_t len) {
+    std::uint64_t hash = 0xCBF29CE484222325ULL;
+    for (std::size_t i = 0; i < len; i++) {
+        hash ^= static_cast<unsigned char>(str[i]);
+        hash *= 0x100000001B3ULL;
+    }
+    return static_cast<std::size_t>(hash);
+}
+
+inline std::size_t flat_hash(const int val) {
+    return mix_bits(static_cast<std::uint32_t>(val));
+}
+
+inline std::size_t flat_hash(const double val) {
+    return mix_bits(double_bits(val));
+}
+
+inline std::size_t flat_hash(const std::complex<double>& val) {
+    return mix_bits(double_bits(val.real()) ^ mix_bits(double_bits(val.imag())));
+}
+
+inline std::size_t flat_hash(const void *ptr) {
+    return mix_bits(reinterpret_cast<std::uintptr_t>(ptr));
+}
+
+// =================================================================================================
+// blocked Bloom filter: a value sets one bit in each word of a 64-byte block,
+// so checking it touches a single cache line
+
+class BloomFilter
+{
+public:
+    bool empty() const {
+        return words_.empty();
+    }
+
+    void reset(const std::size_t num_values) {
+        std::size_t num_blocks = 1;
+        while (num_blocks * 64 * WORDS_PER_BLOCK < num_values * BITS_PER_VALUE) num_blocks <<= 1;
+
+        words_.assign(num_blocks * WORDS_PER_BLOCK, 0);
+        mask_ = num_blocks - 1;
+    }
+
+    void add(const std::size_t hash) {
+        std::uint64_t bits = remix(hash);
+        std::uint64_t *block = &words_[block_of(bits)];
+
+        for (int i = 0; i < WORDS_PER_BLOCK; i++) {
+            block[i] |= bit_of(bits, i);
+        }
+    }
+
+    bool may_contain(const std::size_t hash) const {
+        std::uint64_t bits = remix(hash);
+        const std::uint64_t *block = &words_[block_of(bits)];
+
+        bool ans = true;
+        for (int i = 0; i < WORDS_PER_BLOCK; i++) {
+            ans &= (block[i] & bit_of(bits, i)) != 0;
+        }
+
+        return ans;
+    }
+
+private:
+    static const int WORDS_PER_BLOCK = 8;
+    static const std::size_t BITS_PER_VALUE = 8;
+
+    // hash tables use the low bits of the hash directly
+    static std::uint64_t remix(const std::size_t hash) {
+        return static_cast<std::uint64_t>(hash) * 0x9E3779B97F4A7C15ULL;
+    }
+
+    std::size_t block_of(const std::uint64_t bits) const {
+        return static_cast<std::size_t>((bits >> 40) & mask_) * WORDS_PER_BLOCK;
+    }
+
+    static std::uint64_t bit_of(const std::uint64_t bits, const int i) {
+        return std::uint64_t(1) << ((bits >> (5 * i)) & 63);
+    }
+
+    std::vector<std::uint64_t> words_;
+    std::uint64_t mask_ = 0;
+};
+
+// =================================================================================================
+// open-addressing hash set that is filled once and then queried, possibly from several threads;
+// NaN must not be inserted because it isn't equal to itself
+
+template<typename T>
+class FlatSet
+{
+public:
+    void insert(const T& val) {
+        if (contains(val)) return;
+        if (2 * (size_ + 1) > slots_.size()) grow();
+        place(val);
+    }
+
+    bool contains(const T& val) const {
+        if (size_ == 0) return false;
+
+        std::size_t hash = flat_hash(val);
+        if (!filter_.empty() && !filter_.may_contain(hash)) return false;
+
+        std::size_t mask = slots_.size() - 1;
+        for (std::size_t slot = hash & mask; used_[slot]; slot = (slot + 1) & mask) {
+            if (slots_[slot] == val) return true;
+        }
+
+        return false;
+    }
+
+    std::size_t size() const {
+        return size_;
+    }
+
+    /*
+     * To call after the last insert. Probing a table that doesn't fit in cache misses even for values
+     * that aren't there, so large sets get a prefilter that rejects most of those in one cache line.
+     * It only pays off if most lookups miss, see benchmarks/row_in-target-sets.R
+     */
+    void seal() {
+        if (size_ < BLOOM_MIN_SIZE || !filter_.empty()) return;
+
+        filter_.reset(size_);
+        for (std::size_t slot = 0; slot < slots_.size(); slot++) {
+            if (used_[slot]) filter_.add(flat_hash(slots_[slot]));
+        }
+    }
+
+private:
+    static const std::size_t BLOOM_MIN_SIZE = 65536;
+
+    void place(const T& val) {
+        std::size_t hash = flat_hash(val);
+        std::size_t mask = slots_.size() - 1;
+        std::size_t slot = hash & mask;
+        while (used_[slot]) slot = (slot + 1) & mask;
+
+        slots_[slot] = val;
+        used_[slot] = 1;
+        size_++;
+
+        if (!filter_.empty()) filter_.add(hash);
+    }
+
+    void grow() {
+        std::vector<T> values;
+        for (std::size_t slot = 0; slot < slots_.size(); slot++) {
+            if (used_[slot]) values.push_back(slots_[slot]);
+        }
+
+        std::size_t num_slots = slots_.empty() ? 16 : 2 * slots_.size();
+        slots_.assign(num_slots, T());
+        used_.assign(num_slots, 0);
+        size_ = 0;
+
+        for (const T& val : values) {
+            place(val);
+        }
+    }
+
+    std::vector<T> slots_;
+    std::vector<unsigned char> used_;
+    std::size_t size_ = 0;
+
+    BloomFilter filter_;
+};
+
+} // namespace wiserow
+
+#endif // WISEROW_FLATSET_H_
@@ -0,0 +1,14 @@
+#include "SimdUtils.h"
+
+namespace wiserow {
+
+SimdLevel simd_level() {
+#ifdef WISEROW_X86_SIMD
+    static const SimdLevel level = __builtin_cpu_supports("avx2") ? SimdLevel::AVX2 : SimdLevel::SSE2;
+    return level;
+#else
+    return SimdLevel::SCALAR;
+#endif
+}
+
+} // namespace wiserow
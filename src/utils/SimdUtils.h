@@ -0,0 +1,24 @@
+#ifndef WISEROW_SIMDUTILS_H_
+#define WISEROW_SIMDUTILS_H_
+
+// SSE2 is part of x86-64, AVX2 is only used after checking the CPU at runtime
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#define WISEROW_X86_SIMD
+#define WISEROW_TARGET_AVX2 __attribute__((target("avx2")))
+#include <immintrin.h>
+#endif
+
+namespace wiserow {
+
+enum class SimdLevel {
+    SCALAR,
+    SSE2,
+    AVX2
+};
+
+// detected once per session
+SimdLevel simd_level();
+
+} // namespace wiserow
+
+#endif // WISEROW_SIMDUTILS_H_
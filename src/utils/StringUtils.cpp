@@ -1,62 +1,203 @@
 #include "StringUtils.h"
 
+#include <cerrno>
+#include <climits> // INT_MAX
+#include <cmath> // fabs, floor, isinf, isnan
+#include <cstdint>
+#include <cstdio> // snprintf
+#include <cstdlib> // abs, atoi, strtod, strtol
+#include <cstring> // memcpy, strcmp
 #include <stdexcept>
 
-#include "../visitors.h"
-
 namespace wiserow {
 
-static std::shared_ptr<BooleanVisitor> inf_visitor = BooleanVisitorBuilder().is_inf().build();
+namespace {
 
-// =================================================================================================
+char *write_chars(const char *str, char *out) {
+    while (*str) *out++ = *str++;
+    return out;
+}
 
-// dummy for some templates, shouldn't be used after optimizations
-std::string to_string(const boost::string_ref val) { // nocov start
-    throw std::runtime_error("Unwanted conversion between boost::string_ref and std::string.");
-} // nocov end
+char *write_uint(std::uint64_t val, char *out) {
+    char reversed[20];
+    int n = 0;
 
-std::string to_string(const bool val) {
-    return val ? "TRUE" : "FALSE";
-}
+    do {
+        reversed[n++] = static_cast<char>('0' + val % 10);
+        val /= 10;
+    } while (val > 0);
 
-std::string to_string(const int val) {
-    return std::to_string(val);
+    while (n > 0) *out++ = reversed[--n];
+    return out;
 }
 
-std::string to_string(const double val) {
-    if ((*inf_visitor)(val)) {
-        return val > 0 ? "Inf" : "-Inf";
+// like R's formatReal for a single value: fixed notation unless scientific is narrower
+char *write_digits(const double val, const char *digits, const int nsig, const int kpower, char *out) {
+    int rgt = nsig - kpower - 1 > 0 ? nsig - kpower - 1 : 0;
+    int fixed_width = (kpower >= 0 ? kpower + 1 : 1) + (rgt > 0 ? rgt + 1 : 0);
+    int sci_width = (nsig > 1 ? nsig : 0) + 4 + (kpower >= 100 || kpower <= -99 ? 2 : 1);
+
+    if (fixed_width <= sci_width && kpower >= 15) {
+        // R prints all integer digits here, not only the significant ones
+        return out + std::snprintf(out, 32, "%.0f", val);
+    }
+
+    if (val < 0) *out++ = '-';
+
+    if (fixed_width <= sci_width) {
+        if (kpower < 0) {
+            *out++ = '0';
+            *out++ = '.';
+            for (int i = -1; i > kpower; i--) *out++ = '0';
+            for (int i = 0; i < nsig; i++) *out++ = digits[i];
+        }
+        else {
+            for (int i = 0; i <= kpower; i++) *out++ = i < nsig ? digits[i] : '0';
+            if (rgt > 0) *out++ = '.';
+            for (int i = kpower + 1; i < nsig; i++) *out++ = digits[i];
+        }
     }
     else {
-        // https://stackoverflow.com/a/13709929/5793905
-        std::string str = std::to_string(val);
-        str.erase(str.find_last_not_of("0") + 1, std::string::npos);
-        str.erase(str.find_last_not_of(".") + 1, std::string::npos);
-        return str;
+        *out++ = digits[0];
+        if (nsig > 1) *out++ = '.';
+        for (int i = 1; i < nsig; i++) *out++ = digits[i];
+
+        *out++ = 'e';
+        *out++ = kpower < 0 ? '-' : '+';
+        if (std::abs(kpower) < 10) *out++ = '0';
+        out = write_uint(std::abs(kpower), out);
     }
+
+    return out;
 }
 
-std::string to_string(const std::complex<double>& val) {
-    double imag = val.imag();
+char *write_double(const double val, char *out) {
+    if (std::isnan(val)) return write_chars("NaN", out);
+    if (std::isinf(val)) return write_chars(val > 0 ? "Inf" : "-Inf", out);
+    if (val == 0) return write_chars("0", out);
 
-    if ((*inf_visitor)(val)) {
-        std::string real = val.real() > 0 ? "Inf" : "-Inf";
+    double abs_val = std::fabs(val);
+    char digits[20];
+    int nsig, kpower;
 
-        if (imag >= 0) {
-            return real + "+" + ::wiserow::to_string(imag) + "i";
-        }
-        else {
-            return real + ::wiserow::to_string(imag) + "i";
-        }
+    if (abs_val < 1e15 && abs_val == std::floor(abs_val)) {
+        // whole numbers with at most 15 digits are exact
+        char *end = write_uint(static_cast<std::uint64_t>(abs_val), digits);
+        nsig = static_cast<int>(end - digits);
+        kpower = nsig - 1;
     }
     else {
-        if (imag >= 0) {
-            return ::wiserow::to_string(val.real()) + "+" + ::wiserow::to_string(imag) + "i";
+        // d.dddddddddddddde+XX
+        char sci[32];
+        std::snprintf(sci, sizeof(sci), "%.14e", abs_val);
+
+        digits[0] = sci[0];
+        std::memcpy(digits + 1, sci + 2, 14);
+        nsig = 15;
+        kpower = std::atoi(sci + 17);
+    }
+
+    while (nsig > 1 && digits[nsig - 1] == '0') nsig--;
+    return write_digits(val, digits, nsig, kpower, out);
+}
+
+} // anonymous namespace
+
+// =================================================================================================
+
+// dummy for some templates, shouldn't be used after optimizations
+NumberString::NumberString(const boost::string_ref val) { // nocov start
+    throw std::runtime_error("Unwanted conversion between boost::string_ref and NumberString.");
+} // nocov end
+
+NumberString::NumberString(const bool val) {
+    size_ = write_chars(val ? "TRUE" : "FALSE", buf_) - buf_;
+}
+
+NumberString::NumberString(const int val) {
+    char *out = buf_;
+    if (val < 0) *out++ = '-';
+
+    std::int64_t abs_val = val < 0 ? -static_cast<std::int64_t>(val) : val;
+    size_ = write_uint(static_cast<std::uint64_t>(abs_val), out) - buf_;
+}
+
+NumberString::NumberString(const double val) {
+    size_ = write_double(val, buf_) - buf_;
+}
+
+NumberString::NumberString(const std::complex<double>& val) {
+    char *out = write_double(val.real(), buf_);
+    if (!(val.imag() < 0)) *out++ = '+';
+    out = write_double(val.imag(), out);
+    *out++ = 'i';
+    size_ = out - buf_;
+}
+
+// -------------------------------------------------------------------------------------------------
+
+namespace {
+
+// longer strings can't be something NumberString printed
+bool copy_number(const boost::string_ref str, char *buf, const std::size_t size) {
+    if (str.empty() || str.size() >= size) return false;
+
+    std::memcpy(buf, str.data(), str.size());
+    buf[str.size()] = '\0';
+    return true;
+}
+
+} // anonymous namespace
+
+bool parse_number(const boost::string_ref str, int& val) {
+    char buf[32];
+    if (!copy_number(str, buf, sizeof(buf))) return false;
+
+    errno = 0;
+    char *end;
+    long parsed = std::strtol(buf, &end, 10);
+    if (*end != '\0' || errno != 0 || parsed <= INT_MIN || parsed > INT_MAX) return false;
+
+    val = static_cast<int>(parsed);
+    return NumberString(val).str() == str;
+}
+
+bool parse_number(const boost::string_ref str, double& val) {
+    char buf[32];
+    if (!copy_number(str, buf, sizeof(buf))) return false;
+
+    char *end;
+    double parsed = std::strtod(buf, &end);
+    if (*end != '\0' || std::isnan(parsed)) return false;
+
+    val = parsed;
+    return NumberString(val).str() == str;
+}
+
+// =================================================================================================
+
+void CharsxpSet::insert(SEXP charsxp) {
+    if (lookup_.contains(charsxp)) return;
+
+    members_.push_back(charsxp);
+    lookup_.insert(charsxp);
+
+    for (const char *c = CHAR(charsxp); *c; c++) {
+        if (static_cast<unsigned char>(*c) > 127) {
+            encodings_ |= encoding_bit(charsxp);
+            break;
         }
-        else {
-            return ::wiserow::to_string(val.real()) + ::wiserow::to_string(imag) + "i";
+    }
+}
+
+bool CharsxpSet::find_bytes(SEXP charsxp) const {
+    for (SEXP member : members_) {
+        if (LENGTH(member) == LENGTH(charsxp) && std::strcmp(CHAR(member), CHAR(charsxp)) == 0) {
+            return true;
         }
     }
+
+    return false;
 }
 
 } // namespace wiserow
@@ -2,17 +2,95 @@
 #define WISEROW_STRINGUTILS_H_
 
 #include <complex>
+#include <cstddef> // size_t
 #include <string>
+#include <vector>
+
+#define R_NO_REMAP
+#include <Rinternals.h> // SEXP
 
 #include <boost/utility/string_ref.hpp>
 
+#include "FlatSet.h"
+
 namespace wiserow {
 
-std::string to_string(const boost::string_ref val);
-std::string to_string(const bool val);
-std::string to_string(const int val);
-std::string to_string(const double val);
-std::string to_string(const std::complex<double>& val);
+// numbers as R's as.character would print them (15 significant digits, scipen = 0),
+// formatted in place so comparisons against strings don't allocate
+
+class NumberString
+{
+public:
+    NumberString() : size_(0) {}
+
+    explicit NumberString(const boost::string_ref val);
+    explicit NumberString(const bool val);
+    explicit NumberString(const int val);
+    explicit NumberString(const double val);
+    explicit NumberString(const std::complex<double>& val);
+
+    boost::string_ref str() const {
+        return boost::string_ref(buf_, size_);
+    }
+
+private:
+    char buf_[64]; // enough for 2 doubles
+    std::size_t size_;
+};
+
+// only if str is exactly how NumberString would print val
+bool parse_number(const boost::string_ref str, int& val);
+bool parse_number(const boost::string_ref str, double& val);
+
+struct StringRefHash
+{
+    std::size_t operator()(const boost::string_ref& str) const {
+        return hash_bytes(str.data(), str.size());
+    }
+};
+
+// =================================================================================================
+// R caches CHARSXPs, so equal strings with the same encoding share the pointer,
+// and ASCII strings always have the native encoding
+
+enum class CharIdentity {
+    SAME,
+    DIFFERENT,
+    UNKNOWN // bytes must be compared
+};
+
+class CharsxpSet
+{
+public:
+    void insert(SEXP charsxp);
+
+    // see FlatSet::seal
+    void seal() {
+        lookup_.seal();
+    }
+
+    bool empty() const {
+        return members_.empty();
+    }
+
+    CharIdentity find(SEXP charsxp) const {
+        if (lookup_.contains(charsxp)) return CharIdentity::SAME;
+        if (encodings_ & ~encoding_bit(charsxp)) return CharIdentity::UNKNOWN;
+        return CharIdentity::DIFFERENT;
+    }
+
+    // for CharIdentity::UNKNOWN
+    bool find_bytes(SEXP charsxp) const;
+
+private:
+    static unsigned int encoding_bit(SEXP charsxp) {
+        return 1u << Rf_getCharCE(charsxp);
+    }
+
+    std::vector<SEXP> members_;
+    FlatSet<SEXP> lookup_;
+    unsigned int encodings_ = 0; // of the non-ASCII members
+};
 
 } // namespace wiserow
 
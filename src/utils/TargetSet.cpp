@@ -0,0 +1,189 @@
+#include "TargetSet.h"
+
+#include <climits> // INT_MAX
+
+namespace wiserow {
+
+TargetSet::TargetSet(SEXP targets)
+    : type_(NILSXP)
+    , include_na_(false)
+{
+    R_xlen_t n = Rf_xlength(targets);
+    if (n == 0) return;
+
+    if (TYPEOF(targets) != STRSXP) formatted_ = Rcpp::StringVector(n);
+
+    switch(TYPEOF(targets)) {
+    case INTSXP:
+    case LGLSXP: {
+        type_ = INTSXP;
+        Rcpp::IntegerVector vec(targets);
+
+        for (R_xlen_t i = 0; i < n; i++) {
+            if (vec[i] == NA_INTEGER) {
+                include_na_ = true;
+            }
+            else {
+                ints_.insert(vec[i]);
+                add_formatted(i, NumberString(vec[i]));
+            }
+        }
+
+        break;
+    }
+    case REALSXP: {
+        type_ = REALSXP;
+        Rcpp::NumericVector vec(targets);
+
+        for (R_xlen_t i = 0; i < n; i++) {
+            if (Rcpp::NumericVector::is_na(vec[i])) {
+                include_na_ = true;
+            }
+            else {
+                doubles_.insert(vec[i]);
+                add_formatted(i, NumberString(vec[i]));
+            }
+        }
+
+        break;
+    }
+    case CPLXSXP: {
+        type_ = CPLXSXP;
+        Rcpp::ComplexVector vec(targets);
+        const std::complex<double> *vals = reinterpret_cast<const std::complex<double> *>(&vec[0]);
+
+        for (R_xlen_t i = 0; i < n; i++) {
+            if (Rcpp::NumericVector::is_na(vals[i].real()) || Rcpp::NumericVector::is_na(vals[i].imag())) {
+                include_na_ = true;
+            }
+            else {
+                complexes_.insert(vals[i]);
+                add_formatted(i, NumberString(vals[i]));
+            }
+        }
+
+        break;
+    }
+    case STRSXP: {
+        type_ = STRSXP;
+
+        for (R_xlen_t i = 0; i < n; i++) {
+            SEXP charsxp = STRING_ELT(targets, i);
+
+            if (charsxp == NA_STRING) {
+                include_na_ = true;
+            }
+            else {
+                charsxps_.insert(charsxp);
+                strings_.insert(boost::string_ref(CHAR(charsxp), LENGTH(charsxp)));
+
+                int val;
+                if (parse_number(boost::string_ref(CHAR(charsxp), LENGTH(charsxp)), val)) ints_.insert(val);
+            }
+        }
+
+        break;
+    }
+    default: {
+        return;
+    }
+    }
+
+    ints_.seal();
+    doubles_.seal();
+    complexes_.seal();
+    charsxps_.seal();
+}
+
+// numbers as strings are ASCII, so string cells with the same bytes are these same CHARSXPs
+void TargetSet::add_formatted(const R_xlen_t k, const NumberString& str) {
+    SEXP formatted = formatted_;
+    SEXP charsxp = Rf_mkCharLen(str.str().data(), static_cast<int>(str.str().size()));
+    SET_STRING_ELT(formatted, k, charsxp);
+
+    charsxps_.insert(charsxp);
+    strings_.insert(boost::string_ref(CHAR(charsxp), LENGTH(charsxp)));
+}
+
+// -------------------------------------------------------------------------------------------------
+
+bool TargetSet::contains(const int val) const {
+    if (val == NA_INTEGER) return include_na_;
+
+    switch(type_) {
+    case INTSXP:
+    case STRSXP:
+        return ints_.contains(val);
+    case REALSXP:
+        return doubles_.contains(static_cast<double>(val));
+    case CPLXSXP:
+        return complexes_.contains(std::complex<double>(val, 0));
+    default:
+        return false;
+    }
+}
+
+bool TargetSet::contains(const double val) const {
+    if (Rcpp::NumericVector::is_na(val)) return include_na_;
+
+    switch(type_) {
+    case INTSXP:
+        return contains_whole(val);
+    case REALSXP:
+        return doubles_.contains(val);
+    case CPLXSXP:
+        return complexes_.contains(std::complex<double>(val, 0));
+    case STRSXP:
+        return strings_.find(NumberString(val).str()) != strings_.end();
+    default:
+        return false;
+    }
+}
+
+bool TargetSet::contains(const std::complex<double>& val) const {
+    if (Rcpp::NumericVector::is_na(val.real()) || Rcpp::NumericVector::is_na(val.imag())) return include_na_;
+
+    switch(type_) {
+    case INTSXP:
+        return val.imag() == 0 && contains_whole(val.real());
+    case REALSXP:
+        return val.imag() == 0 && doubles_.contains(val.real());
+    case CPLXSXP:
+        return complexes_.contains(val);
+    case STRSXP:
+        return strings_.find(NumberString(val).str()) != strings_.end();
+    default:
+        return false;
+    }
+}
+
+bool TargetSet::contains(SEXP charsxp) const {
+    if (charsxp == NA_STRING) return include_na_;
+    if (empty()) return false;
+
+    switch(charsxps_.find(charsxp)) {
+    case CharIdentity::SAME:
+        return true;
+    case CharIdentity::DIFFERENT:
+        return false;
+    case CharIdentity::UNKNOWN:
+        break;
+    }
+
+    return strings_.find(boost::string_ref(CHAR(charsxp), LENGTH(charsxp))) != strings_.end();
+}
+
+bool TargetSet::contains_logical(const int val) const {
+    if (val == NA_INTEGER) return include_na_;
+    return strings_.find(val == 0 ? "FALSE" : "TRUE") != strings_.end();
+}
+
+// -------------------------------------------------------------------------------------------------
+
+// integer targets only match whole numbers
+bool TargetSet::contains_whole(const double val) const {
+    if (val <= INT_MIN || val > INT_MAX || val != static_cast<int>(val)) return false;
+    return ints_.contains(static_cast<int>(val));
+}
+
+} // namespace wiserow
@@ -0,0 +1,66 @@
+#ifndef WISEROW_TARGETSET_H_
+#define WISEROW_TARGETSET_H_
+
+#include <complex>
+#include <unordered_set>
+
+#include <Rcpp.h>
+#include <boost/utility/string_ref.hpp>
+
+#include "FlatSet.h"
+#include "StringUtils.h"
+
+namespace wiserow {
+
+/*
+ * The values of one of row_in's target sets, compiled once for each type a cell can have,
+ * so that cells are looked up without being formatted as strings (except for doubles and complex
+ * numbers against string targets, which use a NumberString).
+ *
+ * Numbers match numerically (complex numbers only match reals if their imaginary part is 0),
+ * strings match byte by byte, numbers and strings match if the number's string representation does,
+ * and NA cells match if the set has any NA.
+ */
+class TargetSet
+{
+public:
+    TargetSet(SEXP targets);
+
+    // empty sets match nothing, not even with negation
+    bool empty() const {
+        return type_ == NILSXP;
+    }
+
+    bool is_string() const {
+        return type_ == STRSXP;
+    }
+
+    // NA cells are in the set if the targets had NA
+    bool contains(const int val) const;
+    bool contains(const double val) const;
+    bool contains(const std::complex<double>& val) const;
+    bool contains(SEXP charsxp) const;
+
+    // logicals against string targets are "TRUE" or "FALSE"
+    bool contains_logical(const int val) const;
+
+private:
+    void add_formatted(const R_xlen_t k, const NumberString& str);
+    bool contains_whole(const double val) const;
+
+    SEXPTYPE type_; // logical targets are integers
+    bool include_na_;
+
+    FlatSet<int> ints_; // if targets are strings, the ones that look like integers
+    FlatSet<double> doubles_;
+    FlatSet<std::complex<double>> complexes_;
+
+    // string targets, or how numeric targets look as strings
+    CharsxpSet charsxps_;
+    std::unordered_set<boost::string_ref, StringRefHash> strings_; // point to the CHARSXPs' data
+    Rcpp::StringVector formatted_; // protects the CHARSXPs made for numeric targets
+};
+
+} // namespace wiserow
+
+#endif // WISEROW_TARGETSET_H_
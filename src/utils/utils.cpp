@@ -1,5 +1,10 @@
 #include "../utils.h"
 
+#include "ArithKernels.cpp"
 #include "ArithUtils.cpp"
+#include "BooleanKernels.cpp"
 #include "BooleanUtils.cpp"
+#include "ExtremaKernels.cpp"
+#include "SimdUtils.cpp"
 #include "StringUtils.cpp"
+#include "TargetSet.cpp"
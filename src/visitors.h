@@ -2,6 +2,7 @@
 #define WISEROW_VISITORS_H_
 
 #include "visitors/boolean-visitors.h"
+#include "visitors/BooleanPredicate.h"
 #include "visitors/BooleanVisitor.h"
 #include "visitors/NumericVisitor.h"
 
@@ -0,0 +1,139 @@
+#ifndef WISEROW_BOOLEANPREDICATE_H_
+#define WISEROW_BOOLEANPREDICATE_H_
+
+#include <cmath> // isfinite, isnan
+#include <complex>
+#include <memory> // shared_ptr
+#include <vector>
+
+#define R_NO_REMAP
+#include <Rinternals.h> // NA_INTEGER, NA_STRING
+
+#include <boost/utility/string_ref.hpp>
+
+#include "../utils.h"
+#include "boolean-visitors.h"
+#include "BooleanVisitor.h"
+
+namespace wiserow {
+
+/*
+ * A builder's chain of decorators lowered to a flat program. Steps run in the order they were
+ * added until the result short-circuits the boolean operator, which is what the nested super()
+ * calls do, but each cell costs a loop over a few switches instead of one virtual call per
+ * decorator.
+ */
+class BooleanPredicate
+{
+public:
+    typedef bool result_type;
+
+    BooleanPredicate(const BoolOp op,
+                     const bool init,
+                     const std::vector<PredicateStep>& steps,
+                     const std::shared_ptr<BooleanVisitor>& chain)
+        : op_(op)
+        , init_(init)
+        , steps_(steps)
+        , chain_(chain)
+        , na_string_(CHAR(NA_STRING))
+    { }
+
+    bool operator()(const int val) const { return run(val); }
+    bool operator()(const double val) const { return run(val); }
+    bool operator()(const boost::string_ref val) const { return run(val); }
+    bool operator()(const std::complex<double>& val) const { return run(val); }
+
+private:
+    template<typename T>
+    bool run(const T& val) const {
+        bool ans = init_;
+
+        for (const PredicateStep& step : steps_) {
+            if (short_circuit(ans)) break;
+            ans = test(step, val);
+        }
+
+        return ans;
+    }
+
+    bool short_circuit(const bool val) const {
+        return op_ == BoolOp::AND ? !val : val;
+    }
+
+    // -------------------------------------------------------------------------------------------------
+
+    template<typename T>
+    static bool compare(const PredicateStep& step, const T& val) {
+        switch (step.kind) {
+        case PredicateStep::COMPARE_INT:
+            return static_cast<const ComparisonVisitor<int> *>(step.visitor)->test(val);
+        case PredicateStep::COMPARE_DOUBLE:
+            return static_cast<const ComparisonVisitor<double> *>(step.visitor)->test(val);
+        case PredicateStep::COMPARE_BOOL:
+            return static_cast<const ComparisonVisitor<bool> *>(step.visitor)->test(val);
+        case PredicateStep::COMPARE_COMPLEX:
+            return static_cast<const ComparisonVisitor<std::complex<double>> *>(step.visitor)->test(val);
+        case PredicateStep::COMPARE_STRING:
+            return static_cast<const ComparisonVisitor<boost::string_ref> *>(step.visitor)->test(val);
+        default: // nocov start, the other kinds are handled by test
+            return (*step.visitor)(val);
+        } // nocov end
+    }
+
+    bool test(const PredicateStep& step, const int val) const {
+        switch (step.kind) {
+        case PredicateStep::IS_NA:
+            return (val == NA_INTEGER) ^ step.negate;
+        case PredicateStep::IS_INF:
+            return step.negate;
+        default:
+            return compare(step, val);
+        }
+    }
+
+    bool test(const PredicateStep& step, const double val) const {
+        switch (step.kind) {
+        case PredicateStep::IS_NA:
+            return std::isnan(val) ^ step.negate;
+        case PredicateStep::IS_INF:
+            return (!std::isnan(val) && !std::isfinite(val)) ^ step.negate;
+        default:
+            return compare(step, val);
+        }
+    }
+
+    bool test(const PredicateStep& step, const boost::string_ref val) const {
+        switch (step.kind) {
+        case PredicateStep::IS_NA:
+            return (val.data() == na_string_) ^ step.negate;
+        case PredicateStep::IS_INF:
+            return false; // not negated, see InfiniteVisitor
+        default:
+            return compare(step, val);
+        }
+    }
+
+    bool test(const PredicateStep& step, const std::complex<double>& val) const {
+        bool is_na = std::isnan(val.real()) || std::isnan(val.imag());
+
+        switch (step.kind) {
+        case PredicateStep::IS_NA:
+            return is_na ^ step.negate;
+        case PredicateStep::IS_INF:
+            return (!is_na && (!std::isfinite(val.real()) || !std::isfinite(val.imag()))) ^ step.negate;
+        default:
+            return compare(step, val);
+        }
+    }
+
+    const BoolOp op_;
+    const bool init_;
+    const std::vector<PredicateStep> steps_;
+    const std::shared_ptr<BooleanVisitor> chain_; // owns the decorators that steps point to
+    const char *na_string_;
+};
+
+} // namespace wiserow
+
+#endif // WISEROW_BOOLEANPREDICATE_H_
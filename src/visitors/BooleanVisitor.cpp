@@ -1,11 +1,9 @@
 #include "BooleanVisitor.h"
 
-#include <unordered_set>
-#include <utility> // move
-
 #include <Rcpp.h>
 
 #include "boolean-visitors.h"
+#include "BooleanPredicate.h"
 
 namespace wiserow {
 
@@ -57,13 +55,21 @@ bool BooleanVisitorDecorator::forward(const bool ans) const {
 
 BooleanVisitorBuilder::BooleanVisitorBuilder(const BoolOp op, const bool init)
     : op_(op)
+    , init_(init)
     , visitor_(std::make_shared<InitBooleanVisitor>(init))
 { }
 
 // -------------------------------------------------------------------------------------------------
 
+void BooleanVisitorBuilder::lower(const PredicateStep::Kind kind, const bool negate) {
+    steps_.push_back({ kind, negate, visitor_.get() });
+}
+
+// -------------------------------------------------------------------------------------------------
+
 BooleanVisitorBuilder& BooleanVisitorBuilder::is_na(const bool negate) {
     visitor_ = std::make_shared<NAVisitor>(op_, visitor_, negate);
+    lower(PredicateStep::IS_NA, negate);
     return *this;
 }
 
@@ -71,6 +77,7 @@ BooleanVisitorBuilder& BooleanVisitorBuilder::is_na(const bool negate) {
 
 BooleanVisitorBuilder& BooleanVisitorBuilder::is_inf(const bool negate) {
     visitor_ = std::make_shared<InfiniteVisitor>(op_, visitor_, negate);
+    lower(PredicateStep::IS_INF, negate);
     return *this;
 }
 
@@ -86,9 +93,11 @@ BooleanVisitorBuilder& BooleanVisitorBuilder::compare(const CompOp comp_op, cons
 
         if (Rcpp::traits::is_na<INTSXP>(val)) {
             visitor_ = std::make_shared<NAVisitor>(op_, visitor_, negate);
+            lower(PredicateStep::IS_NA, negate);
         }
         else {
             visitor_ = std::make_shared<ComparisonVisitor<int>>(op_, comp_op, val, visitor_);
+            lower(PredicateStep::COMPARE_INT, false);
         }
 
         break;
@@ -99,9 +108,11 @@ BooleanVisitorBuilder& BooleanVisitorBuilder::compare(const CompOp comp_op, cons
 
         if (Rcpp::traits::is_na<REALSXP>(val)) {
             visitor_ = std::make_shared<NAVisitor>(op_, visitor_, negate);
+            lower(PredicateStep::IS_NA, negate);
         }
         else {
             visitor_ = std::make_shared<ComparisonVisitor<double>>(op_, comp_op, val, visitor_);
+            lower(PredicateStep::COMPARE_DOUBLE, false);
         }
 
         break;
@@ -112,9 +123,11 @@ BooleanVisitorBuilder& BooleanVisitorBuilder::compare(const CompOp comp_op, cons
 
         if (Rcpp::traits::is_na<LGLSXP>(val)) {
             visitor_ = std::make_shared<NAVisitor>(op_, visitor_, negate);
+            lower(PredicateStep::IS_NA, negate);
         }
         else {
             visitor_ = std::make_shared<ComparisonVisitor<bool>>(op_, comp_op, val != 0, visitor_);
+            lower(PredicateStep::COMPARE_BOOL, false);
         }
 
         break;
@@ -125,10 +138,12 @@ BooleanVisitorBuilder& BooleanVisitorBuilder::compare(const CompOp comp_op, cons
 
         if (Rcpp::traits::is_na<CPLXSXP>(val)) {
             visitor_ = std::make_shared<NAVisitor>(op_, visitor_, negate);
+            lower(PredicateStep::IS_NA, negate);
         }
         else {
             std::complex<double> cplx_val(val.r, val.i);
             visitor_ = std::make_shared<ComparisonVisitor<std::complex<double>>>(op_, comp_op, cplx_val, visitor_);
+            lower(PredicateStep::COMPARE_COMPLEX, false);
         }
 
         break;
@@ -138,6 +153,7 @@ BooleanVisitorBuilder& BooleanVisitorBuilder::compare(const CompOp comp_op, cons
 
         if (Rcpp::traits::is_na<STRSXP>(vec[0])) {
             visitor_ = std::make_shared<NAVisitor>(op_, visitor_, negate);
+            lower(PredicateStep::IS_NA, negate);
         }
         else {
             // https://stackoverflow.com/a/7875438/5793905
@@ -145,6 +161,7 @@ BooleanVisitorBuilder& BooleanVisitorBuilder::compare(const CompOp comp_op, cons
             const char *val_ptr = static_cast<char *>(val[0]);
             boost::string_ref str_ref(val_ptr);
             visitor_ = std::make_shared<ComparisonVisitor<boost::string_ref>>(op_, comp_op, str_ref, visitor_);
+            lower(PredicateStep::COMPARE_STRING, false);
         }
 
         break;
@@ -156,67 +173,12 @@ BooleanVisitorBuilder& BooleanVisitorBuilder::compare(const CompOp comp_op, cons
 
 // -------------------------------------------------------------------------------------------------
 
-BooleanVisitorBuilder& BooleanVisitorBuilder::in_set(const SEXP& target_vals, const bool negate) {
-    switch(TYPEOF(target_vals)) {
-    case INTSXP: {
-        Rcpp::IntegerVector vec(target_vals);
-        if (vec.size() > 0) {
-            visitor_ = std::make_shared<InSetVisitor<int>>(op_, visitor_, negate, &vec[0], vec.size());
-        }
-        break;
-    }
-    case REALSXP: {
-        Rcpp::NumericVector vec(target_vals);
-        if (vec.size() > 0) {
-            visitor_ = std::make_shared<InSetVisitor<double>>(op_, visitor_, negate, &vec[0], vec.size());
-        }
-        break;
-    }
-    case LGLSXP: {
-        Rcpp::LogicalVector vec(target_vals);
-        if (vec.size() > 0) {
-            visitor_ = std::make_shared<InSetVisitor<int>>(op_, visitor_, negate, &vec[0], vec.size());
-        }
-        break;
-    }
-    case CPLXSXP: {
-        Rcpp::ComplexVector vec(target_vals);
-        if (vec.size() > 0) {
-            visitor_ = std::make_shared<InSetVisitor<std::complex<double>>>(
-                op_, visitor_, negate, reinterpret_cast<std::complex<double> *>(&vec[0]), vec.size());
-        }
-        break;
-    }
-    case STRSXP: {
-        Rcpp::StringVector vec(target_vals);
-        if (vec.size() > 0) {
-            std::unordered_set<std::string> set;
-            bool any_na = false;
-
-            for (R_xlen_t i = 0; i < vec.size(); i++) {
-                if (Rcpp::traits::is_na<STRSXP>(vec[i])) {
-                    if (!any_na) any_na = true;
-                }
-                else {
-                    Rcpp::CharacterVector val = Rcpp::as<Rcpp::CharacterVector>(vec[i]);
-                    const char *val_ptr = static_cast<char *>(val[0]);
-                    set.insert(std::string(val_ptr));
-                }
-            }
-
-            visitor_ = std::make_shared<InSetVisitor<std::string>>(op_, visitor_, negate, std::move(set), any_na);
-        }
-        break;
-    }
-    }
-
-    return *this;
-}
-
-// -------------------------------------------------------------------------------------------------
-
 std::shared_ptr<BooleanVisitor> BooleanVisitorBuilder::build() {
     return visitor_;
 }
 
+BooleanPredicate BooleanVisitorBuilder::compile() const {
+    return BooleanPredicate(op_, init_, steps_, visitor_);
+}
+
 } // namespace wiserow
@@ -3,6 +3,7 @@
 
 #include <complex>
 #include <memory>
+#include <vector>
 
 #define R_NO_REMAP
 #include <Rinternals.h> // SEXP
@@ -65,6 +66,28 @@ private:
 
 // =================================================================================================
 
+// one decorator of a builder's chain, as BooleanPredicate runs it
+struct PredicateStep
+{
+    enum Kind : unsigned char {
+        IS_NA,
+        IS_INF,
+        COMPARE_INT,
+        COMPARE_DOUBLE,
+        COMPARE_BOOL,
+        COMPARE_COMPLEX,
+        COMPARE_STRING
+    };
+
+    Kind kind;
+    bool negate;
+    const BooleanVisitor *visitor; // the decorator this step was lowered from
+};
+
+class BooleanPredicate;
+
+// -------------------------------------------------------------------------------------------------
+
 class BooleanVisitorBuilder
 {
 public:
@@ -73,13 +96,18 @@ public:
     BooleanVisitorBuilder& is_na(const bool negate = false);
     BooleanVisitorBuilder& is_inf(const bool negate = false);
     BooleanVisitorBuilder& compare(const CompOp comp_op, const SEXP& target_val);
-    BooleanVisitorBuilder& in_set(const SEXP& target_vals, const bool negate = false);
 
     std::shared_ptr<BooleanVisitor> build();
+    BooleanPredicate compile() const;
 
 private:
+    void lower(const PredicateStep::Kind kind, const bool negate);
+
     const BoolOp op_;
+    const bool init_;
     std::shared_ptr<BooleanVisitor> visitor_;
+
+    std::vector<PredicateStep> steps_;
 };
 
 } // namespace wiserow
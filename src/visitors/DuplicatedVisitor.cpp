@@ -1,185 +1,259 @@
 #include "boolean-visitors.h"
 
-#include <algorithm> // find
+#include <cstdint>
+#include <cstring> // memcmp
 
 namespace wiserow {
 
-// TODO: maybe call promote_to before/after na_visitor depending on na_action
+namespace {
 
-bool DuplicatedVisitor::operator()(const bool val) {
-    switch(current_type_) {
-    case Type::BOOL:
-        return !bools_.insert(val).second;
-    case Type::INT:
-        return !ints_.insert(static_cast<int>(val)).second;
-    case Type::DOUBLE:
-        return !doubles_.insert(static_cast<double>(val)).second;
-    case Type::COMPLEX: {
-        std::complex<double> cplx(static_cast<double>(val), 0);
-        bool ans = std::find(complexs_.begin(), complexs_.end(), cplx) != complexs_.end();
-        if (!ans) complexs_.push_back(cplx);
-        return ans;
+inline bool is_ascii(const char *str, const std::size_t len) {
+    for (std::size_t i = 0; i < len; i++) {
+        if (static_cast<unsigned char>(str[i]) > 127) return false;
     }
-    case Type::STRING:
-        return !strings_.insert(::wiserow::to_string(val)).second;
+    return true;
+}
+
+} // anonymous namespace
+
+// =================================================================================================
+
+void DuplicatedVisitor::reset(const std::size_t max_values) {
+    for (const Entry& entry : entries_) {
+        slots_[entry.slot] = 0;
     }
 
-    throw "Unreachable code reached..."; // nocov
+    entries_.clear();
+    pool_.clear();
+
+    current_type_ = Type::BOOL;
+    seen_na_ = false;
+    charsxp_mode_ = true;
+    encodings_ = 0;
+
+    std::size_t num_slots = 16;
+    while (num_slots < 2 * (max_values + 1)) num_slots <<= 1;
+    if (slots_.size() < num_slots) slots_.assign(num_slots, 0);
+}
+
+// -------------------------------------------------------------------------------------------------
+
+bool DuplicatedVisitor::operator()(const bool val) {
+    leave_charsxp_mode();
+    return insert(convert(number(val ? 1 : 0, 0), Type::BOOL, current_type_));
 }
 
 bool DuplicatedVisitor::operator()(const int val) {
+    leave_charsxp_mode();
+
     if (na_visitor_(val)) return handle_na();
 
     promote_to(Type::INT);
-
-    switch(current_type_) {
-    case Type::BOOL:
-    case Type::INT:
-        return !ints_.insert(val).second;
-    case Type::DOUBLE:
-        return !doubles_.insert(static_cast<double>(val)).second;
-    case Type::COMPLEX: {
-        std::complex<double> cplx(val, 0);
-        bool ans = std::find(complexs_.begin(), complexs_.end(), cplx) != complexs_.end();
-        if (!ans) complexs_.push_back(cplx);
-        return ans;
-    }
-    case Type::STRING:
-        return !strings_.insert(::wiserow::to_string(val)).second;
-    }
-
-    throw "Unreachable code reached..."; // nocov
+    return insert(convert(number(val, 0), Type::INT, current_type_));
 }
 
 bool DuplicatedVisitor::operator()(const double val) {
+    leave_charsxp_mode();
+
     if (na_visitor_(val)) return handle_na();
 
     promote_to(Type::DOUBLE);
+    return insert(convert(number(val, 0), Type::DOUBLE, current_type_));
+}
+
+bool DuplicatedVisitor::operator()(const std::complex<double>& val) {
+    leave_charsxp_mode();
+
+    if (na_visitor_(val)) return handle_na();
+
+    promote_to(Type::COMPLEX);
+    return insert(convert(number(val.real(), val.imag()), Type::COMPLEX, current_type_));
+}
+
+bool DuplicatedVisitor::operator()(const boost::string_ref val) {
+    leave_charsxp_mode();
+
+    if (na_visitor_(val)) return handle_na();
+
+    promote_to(Type::STRING);
+    return insert(chars(val.data(), val.size(), nullptr));
+}
+
+bool DuplicatedVisitor::operator()(SEXP val) {
+    if (!charsxp_mode_) return (*this)(boost::string_ref(CHAR(val), LENGTH(val)));
+    if (val == NA_STRING) return handle_na();
+
+    Entry entry = chars(CHAR(val), LENGTH(val), val);
+    std::size_t slot;
+    if (find(entry, slot)) return true;
+
+    // same bytes with a different encoding, see CharsxpSet
+    if (encodings_ & ~(1u << Rf_getCharCE(val))) {
+        for (const Entry& other : entries_) {
+            if (other.len == entry.len && std::memcmp(other.str, entry.str, entry.len) == 0) return true;
+        }
+    }
+
+    if (!is_ascii(entry.str, entry.len)) encodings_ |= 1u << Rf_getCharCE(val);
+
+    place(entry, slot);
+    return false;
+}
+
+// -------------------------------------------------------------------------------------------------
+
+DuplicatedVisitor::Entry DuplicatedVisitor::number(const double re, const double im) {
+    return Entry { re, im, nullptr, nullptr, 0, 0, 0 };
+}
+
+DuplicatedVisitor::Entry DuplicatedVisitor::chars(const char *str, const std::size_t len, SEXP charsxp) const {
+    return Entry { 0, 0, charsxp, str, 0, len, 0 };
+}
+
+DuplicatedVisitor::Entry DuplicatedVisitor::pooled(const boost::string_ref str) {
+    Entry entry { 0, 0, nullptr, nullptr, pool_.size(), str.size(), 0 };
+    pool_.append(str.data(), str.size());
+    return entry;
+}
+
+const char *DuplicatedVisitor::bytes(const Entry& entry) const {
+    return entry.str ? entry.str : pool_.data() + entry.offset;
+}
+
+// -------------------------------------------------------------------------------------------------
+
+std::size_t DuplicatedVisitor::hash(const Entry& entry) const {
+    if (charsxp_mode_) {
+        return mix_bits(reinterpret_cast<std::uintptr_t>(entry.charsxp));
+    }
 
     switch(current_type_) {
     case Type::BOOL:
     case Type::INT:
     case Type::DOUBLE:
-        return !doubles_.insert(static_cast<double>(val)).second;
-    case Type::COMPLEX: {
-        std::complex<double> cplx(val, 0);
-        bool ans = std::find(complexs_.begin(), complexs_.end(), cplx) != complexs_.end();
-        if (!ans) complexs_.push_back(cplx);
-        return ans;
-    }
+        return mix_bits(double_bits(entry.re));
+    case Type::COMPLEX:
+        return mix_bits(double_bits(entry.re) ^ mix_bits(double_bits(entry.im)));
     case Type::STRING:
-        return !strings_.insert(::wiserow::to_string(val)).second;
+        return hash_bytes(bytes(entry), entry.len);
     }
 
-    throw "Unreachable code reached..."; // nocov
+    return 0; // nocov
 }
 
-bool DuplicatedVisitor::operator()(const std::complex<double>& val) {
-    if (na_visitor_(val)) return handle_na();
-
-    promote_to(Type::COMPLEX);
+bool DuplicatedVisitor::equal(const Entry& a, const Entry& b) const {
+    if (charsxp_mode_) {
+        return a.charsxp == b.charsxp;
+    }
 
     switch(current_type_) {
     case Type::BOOL:
     case Type::INT:
     case Type::DOUBLE:
-    case Type::COMPLEX: {
-        bool ans = std::find(complexs_.begin(), complexs_.end(), val) != complexs_.end();
-        if (!ans) complexs_.push_back(val);
-        return ans;
-    }
+        return a.re == b.re;
+    case Type::COMPLEX:
+        return a.re == b.re && a.im == b.im;
     case Type::STRING:
-        return !strings_.insert(::wiserow::to_string(val)).second;
+        return a.len == b.len && std::memcmp(bytes(a), bytes(b), a.len) == 0;
     }
 
-    throw "Unreachable code reached..."; // nocov
+    return false; // nocov
 }
 
-bool DuplicatedVisitor::operator()(const boost::string_ref val) {
-    if (na_visitor_(val)) return handle_na();
+// if not found, slot is where entry should go
+bool DuplicatedVisitor::find(const Entry& entry, std::size_t& slot) {
+    if (2 * (entries_.size() + 1) > slots_.size()) {
+        rehash(slots_.empty() ? 16 : 2 * slots_.size());
+    }
 
-    promote_to(Type::STRING);
+    std::size_t mask = slots_.size() - 1;
+    for (slot = hash(entry) & mask; slots_[slot]; slot = (slot + 1) & mask) {
+        if (equal(entries_[slots_[slot] - 1], entry)) return true;
+    }
 
-    switch(current_type_) {
+    return false;
+}
+
+void DuplicatedVisitor::place(Entry entry, const std::size_t slot) {
+    entry.slot = slot;
+    entries_.push_back(entry);
+    slots_[slot] = entries_.size();
+}
+
+// true if entry was already there
+bool DuplicatedVisitor::insert(const Entry& entry) {
+    std::size_t slot;
+    if (find(entry, slot)) return true;
+
+    place(entry, slot);
+    return false;
+}
+
+// entries are assumed to be unique here
+void DuplicatedVisitor::rehash(const std::size_t num_slots) {
+    slots_.assign(num_slots, 0);
+
+    std::size_t mask = num_slots - 1;
+    for (std::size_t i = 0; i < entries_.size(); i++) {
+        std::size_t slot = hash(entries_[i]) & mask;
+        while (slots_[slot]) slot = (slot + 1) & mask;
+
+        entries_[i].slot = slot;
+        slots_[slot] = i + 1;
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+
+DuplicatedVisitor::Entry DuplicatedVisitor::convert(const Entry& entry, const Type from, const Type to) {
+    if (to != Type::STRING || from == Type::STRING) {
+        return entry;
+    }
+
+    switch(from) {
     case Type::BOOL:
+        return pooled(NumberString(entry.re != 0).str());
     case Type::INT:
+        return pooled(NumberString(static_cast<int>(entry.re)).str());
     case Type::DOUBLE:
+        return pooled(NumberString(entry.re).str());
     case Type::COMPLEX:
+        return pooled(NumberString(std::complex<double>(entry.re, entry.im)).str());
     case Type::STRING:
-        return !strings_.insert(val.to_string()).second;
+        break;
     }
 
-    throw "Unreachable code reached..."; // nocov
+    return entry; // nocov
 }
 
-void DuplicatedVisitor::promote_to(Type type) {
-    switch(type) {
-    case Type::BOOL:
-    case Type::INT:
-        if (current_type_ >= Type::INT) break;
-        ints_.insert(bools_.begin(), bools_.end());
-        current_type_ = Type::INT;
-        break;
-    case Type::DOUBLE:
-        if (current_type_ >= Type::DOUBLE) break;
+// the CHARSXPs become plain strings hashed by their bytes
+void DuplicatedVisitor::leave_charsxp_mode() {
+    if (!charsxp_mode_) return;
+    charsxp_mode_ = false;
 
-        if (current_type_ == Type::BOOL) {
-            doubles_.insert(bools_.begin(), bools_.end());
-        }
-        else if (current_type_ == Type::INT) {
-            doubles_.insert(ints_.begin(), ints_.end());
-        }
+    if (entries_.empty()) return;
 
-        current_type_ = Type::DOUBLE;
-        break;
-    case Type::COMPLEX:
-        if (current_type_ >= Type::COMPLEX) break;
+    current_type_ = Type::STRING;
+    rehash(slots_.size());
+}
 
-        if (current_type_ == Type::BOOL) {
-            for (bool val : bools_) {
-                complexs_.push_back(std::complex<double>(val, 0));
-            }
-        }
-        else if (current_type_ == Type::INT) {
-            for (int val : ints_) {
-                complexs_.push_back(std::complex<double>(val, 0));
-            }
-        }
-        else if (current_type_ == Type::DOUBLE) {
-            for (double val : doubles_) {
-                complexs_.push_back(std::complex<double>(val, 0));
-            }
-        }
+// conversions can make values collide, e.g. doubles that look the same as strings
+void DuplicatedVisitor::promote_to(Type type) {
+    if (current_type_ >= type) return;
 
-        current_type_ = Type::COMPLEX;
-        break;
-    case Type::STRING:
-        if (current_type_ >= Type::STRING) break;
+    Type from = current_type_;
+    current_type_ = type;
 
-        if (current_type_ == Type::BOOL) {
-            for (bool val : bools_) {
-                strings_.insert(::wiserow::to_string(val));
-            }
-        }
-        else if (current_type_ == Type::INT) {
-            for (int val : ints_) {
-                strings_.insert(::wiserow::to_string(val));
-            }
-        }
-        else if (current_type_ == Type::DOUBLE) {
-            for (double val : doubles_) {
-                strings_.insert(::wiserow::to_string(val));
-            }
-        }
-        else if (current_type_ == Type::COMPLEX) {
-            for (std::complex<double>& val : complexs_) {
-                strings_.insert(::wiserow::to_string(val));
-            }
-        }
+    promoted_.swap(entries_);
+    for (const Entry& entry : promoted_) {
+        slots_[entry.slot] = 0;
+    }
 
-        current_type_ = Type::STRING;
-        break;
+    for (const Entry& entry : promoted_) {
+        insert(convert(entry, from, type));
     }
+
+    promoted_.clear();
 }
 
 bool DuplicatedVisitor::handle_na() {
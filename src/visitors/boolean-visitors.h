@@ -1,11 +1,12 @@
 #ifndef WISEROW_BOOLEANVISITORS_H_
 #define WISEROW_BOOLEANVISITORS_H_
 
+#include <cmath> // fabs
 #include <complex>
+#include <cstddef> // size_t
 #include <memory> // shared_ptr
 #include <string>
 #include <type_traits> // is_same
-#include <unordered_set>
 #include <vector>
 
 #include <boost/utility/string_ref.hpp>
@@ -47,6 +48,25 @@ private:
 
 // =================================================================================================
 
+// what a comparison target looks like to string cells
+inline boost::string_ref target_string(const boost::string_ref& target_val, NumberString&) {
+    return target_val;
+}
+
+template<typename T>
+boost::string_ref target_string(const T& target_val, NumberString& formatted) {
+    formatted = NumberString(target_val);
+    return formatted.str();
+}
+
+// -------------------------------------------------------------------------------------------------
+
+/*
+ * Every form of the target that cells might need is prepared in the constructor. Numbers are
+ * compared to strings as R would print them, but for (in)equality against a string target that is
+ * already how R prints a number, int cells can be compared numerically and double cells only need
+ * to be formatted if they are very close to the parsed target.
+ */
 template<typename T>
 class ComparisonVisitor : public BooleanVisitorDecorator
 {
@@ -58,177 +78,109 @@ public:
         : BooleanVisitorDecorator(bool_op, visitor, false)
         , comp_op_(comp_op)
         , target_val_(target_val)
-    { }
-
-    bool operator()(const int val) const override {
-        bool super_ans = super(val);
-        if (short_circuit(super_ans)) return super_ans;
-        return comp_op_.apply(val, target_val_);
-    }
-
-    bool operator()(const double val) const override {
-        bool super_ans = super(val);
-        if (short_circuit(super_ans)) return super_ans;
-        return comp_op_.apply(val, target_val_);
-    }
-
-    bool operator()(const boost::string_ref val) const override {
-        bool super_ans = super(val);
-        if (short_circuit(super_ans)) return super_ans;
-
-        if (std::is_same<T, boost::string_ref>::value) {
-            return comp_op_.apply(val, target_val_);
-        }
-        else {
-            std::string str = ::wiserow::to_string(target_val_);
-            boost::string_ref str_ref(str);
-            return comp_op_.apply(val, str_ref);
-        }
-    }
-
-    bool operator()(const std::complex<double>& val) const override {
-        bool super_ans = super(val);
-        if (short_circuit(super_ans)) return super_ans;
-        return comp_op_.apply(val, target_val_);
-    }
-
-private:
-    const ComparisonOperator comp_op_;
-    const T target_val_;
-};
-
-// =================================================================================================
-// Primary template will be for int and double
-
-template<typename T>
-class InSetVisitor : public BooleanVisitorDecorator
-{
-public:
-    InSetVisitor(const BoolOp bool_op,
-                 const std::shared_ptr<BooleanVisitor>& visitor,
-                 const bool negate,
-                 const T * const target_vals,
-                 const std::size_t n_target_vals)
-        : BooleanVisitorDecorator(bool_op, visitor, negate)
-        , any_target_na_(false)
+        , target_str_(target_string(target_val, formatted_target_))
+        , equality_(comp_op == CompOp::EQ || comp_op == CompOp::NEQ)
+        , negate_(comp_op == CompOp::NEQ)
+        , int_target_(0)
+        , double_target_(0)
+        , is_int_target_(false)
+        , is_double_target_(false)
     {
-        for (std::size_t i = 0; i < n_target_vals; i++) {
-            if (na_visitor_(target_vals[i])) {
-                any_target_na_ = true;
-            }
-            else {
-                target_vals_.insert(target_vals[i]);
-                target_string_vals_.insert(::wiserow::to_string(target_vals[i]));
-            }
+        if (equality_ && std::is_same<T, boost::string_ref>::value) {
+            is_int_target_ = parse_number(target_str_, int_target_);
+            is_double_target_ = parse_number(target_str_, double_target_);
         }
     }
 
     bool operator()(const int val) const override {
         bool super_ans = super(val);
         if (short_circuit(super_ans)) return super_ans;
-
-        if (na_visitor_(val)) return forward(any_target_na_);
-
-        return forward(target_vals_.find(val) != target_vals_.end());
+        return test(val);
     }
 
     bool operator()(const double val) const override {
         bool super_ans = super(val);
         if (short_circuit(super_ans)) return super_ans;
-
-        if (na_visitor_(val)) return forward(any_target_na_);
-        // if set has integers but value is not whole, return false
-        if (std::is_same<T, int>::value && val != static_cast<int>(val)) return forward(false);
-
-        return forward(target_vals_.find(val) != target_vals_.end());
+        return test(val);
     }
 
     bool operator()(const boost::string_ref val) const override {
         bool super_ans = super(val);
         if (short_circuit(super_ans)) return super_ans;
-        if (na_visitor_(val)) return forward(any_target_na_);
-        return forward(target_string_vals_.find(val.to_string()) != target_string_vals_.end());
+        return test(val);
     }
 
     bool operator()(const std::complex<double>& val) const override {
         bool super_ans = super(val);
         if (short_circuit(super_ans)) return super_ans;
-
-        if (na_visitor_(val)) return forward(any_target_na_);
-        if (val.imag() != 0) return forward(false);
-        if (std::is_same<T, int>::value && val.real() != static_cast<int>(val.real())) return forward(false);
-
-        return forward(target_vals_.find(val.real()) != target_vals_.end());
+        return test(val);
     }
 
-private:
-    bool any_target_na_;
-    std::unordered_set<T> target_vals_;
-    std::unordered_set<std::string> target_string_vals_;
-    const NAVisitor na_visitor_;
-};
+    // just this decorator's comparison, for BooleanPredicate
+    bool test(const int val) const { return compare(val, target_val_); }
+    bool test(const double val) const { return compare(val, target_val_); }
+    bool test(const boost::string_ref val) const { return comp_op_.apply(val, target_str_); }
+    bool test(const std::complex<double>& val) const { return comp_op_.apply(val, target_val_); }
 
-// -------------------------------------------------------------------------------------------------
+private:
+    template<typename U>
+    bool compare(const U& val, const T& target_val) const {
+        return comp_op_.apply(val, target_val);
+    }
 
-template<>
-class InSetVisitor<std::complex<double>> : public BooleanVisitorDecorator
-{
-public:
-    InSetVisitor(const BoolOp bool_op,
-                 const std::shared_ptr<BooleanVisitor>& visitor,
-                 const bool negate,
-                 const std::complex<double> * const target_vals,
-                 const std::size_t n_target_vals);
+    bool compare(const int val, const boost::string_ref& target_val) const {
+        if (!equality_) return comp_op_.apply(val, target_val);
+        return (is_int_target_ && val == int_target_) != negate_;
+    }
 
-    bool operator()(const int val) const override;
-    bool operator()(const double val) const override;
-    bool operator()(const boost::string_ref val) const override;
-    bool operator()(const std::complex<double>& val) const override;
+    bool compare(const double val, const boost::string_ref& target_val) const {
+        if (!equality_) return comp_op_.apply(val, target_val);
+        if (!is_double_target_) return negate_;
+        if (val == double_target_) return !negate_;
 
-private:
-    bool any_target_na_;
-    std::vector<std::complex<double>> target_vals_;
-    std::unordered_set<std::string> target_string_vals_;
-    const NAVisitor na_visitor_;
-};
+        // 15 significant digits can't be the same otherwise
+        if (std::fabs(val - double_target_) > std::fabs(double_target_) * 1e-13) return negate_;
+        return comp_op_.apply(val, target_val);
+    }
 
-// -------------------------------------------------------------------------------------------------
+    const ComparisonOperator comp_op_;
+    const T target_val_;
 
-template<>
-class InSetVisitor<std::string> : public BooleanVisitorDecorator
-{
-public:
-    InSetVisitor(const BoolOp bool_op,
-                 const std::shared_ptr<BooleanVisitor>& visitor,
-                 const bool negate,
-                 std::unordered_set<std::string>&& target_vals,
-                 const bool include_na);
+    NumberString formatted_target_; // only for numeric targets, target_str_ may point here
+    const boost::string_ref target_str_;
 
-    bool operator()(const int val) const override;
-    bool operator()(const double val) const override;
-    bool operator()(const boost::string_ref val) const override;
-    bool operator()(const std::complex<double>& val) const override;
+    const bool equality_;
+    const bool negate_;
 
-private:
-    const std::unordered_set<std::string> target_vals_;
-    const bool include_na_;
-    const NAVisitor na_visitor_;
+    // only for string targets
+    int int_target_;
+    double double_target_;
+    bool is_int_target_;
+    bool is_double_target_;
 };
 
 // =================================================================================================
 
+/*
+ * Values are kept in an open-addressing table in the domain of the "highest" type seen so far,
+ * and promoted in place when a higher type shows up. A thread can reuse the same visitor for all
+ * its rows: reset() clears in O(number of values) and keeps the memory.
+ */
 class DuplicatedVisitor : public boost::static_visitor<bool>
 {
 public:
+    void reset(const std::size_t max_values);
+
     bool operator()(const bool val);
     bool operator()(const int val);
     bool operator()(const double val);
     bool operator()(const std::complex<double>& val);
     bool operator()(const boost::string_ref val);
 
-private:
-    const NAVisitor na_visitor_;
+    // strings from CHARSXPs are compared by identity as long as the row has no other types
+    bool operator()(SEXP val);
 
+private:
     enum class Type {
         BOOL,
         INT,
@@ -237,17 +189,47 @@ private:
         STRING
     };
 
-    Type current_type_ = Type::BOOL;
-    bool seen_na_ = false;
+    // numbers are kept in re/im, strings point to CHAR() data or to pool_ if str is null
+    struct Entry
+    {
+        double re;
+        double im;
+        SEXP charsxp;
+        const char *str;
+        std::size_t offset;
+        std::size_t len;
+        std::size_t slot;
+    };
 
-    std::unordered_set<bool> bools_;
-    std::unordered_set<int> ints_;
-    std::unordered_set<double> doubles_;
-    std::vector<std::complex<double>> complexs_;
-    std::unordered_set<std::string> strings_;
+    static Entry number(const double re, const double im);
+    Entry chars(const char *str, const std::size_t len, SEXP charsxp) const;
+    Entry pooled(const boost::string_ref str);
+    const char *bytes(const Entry& entry) const;
 
+    std::size_t hash(const Entry& entry) const;
+    bool equal(const Entry& a, const Entry& b) const;
+    bool find(const Entry& entry, std::size_t& slot);
+    void place(Entry entry, const std::size_t slot);
+    bool insert(const Entry& entry);
+    void rehash(const std::size_t num_slots);
+
+    Entry convert(const Entry& entry, const Type from, const Type to);
+    void leave_charsxp_mode();
     void promote_to(Type type);
     bool handle_na();
+
+    const NAVisitor na_visitor_;
+
+    Type current_type_ = Type::BOOL;
+    bool seen_na_ = false;
+
+    bool charsxp_mode_ = true;
+    unsigned int encodings_ = 0; // of non-ASCII CHARSXPs, see CharsxpSet
+
+    std::vector<Entry> entries_;
+    std::vector<Entry> promoted_;
+    std::vector<std::size_t> slots_; // entry index + 1, 0 if empty
+    std::string pool_;
 };
 
 } // namespace wiserow
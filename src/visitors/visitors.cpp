@@ -3,5 +3,4 @@
 #include "BooleanVisitor.cpp"
 #include "DuplicatedVisitor.cpp"
 #include "InfiniteVisitor.cpp"
-#include "InSetVisitor.cpp"
 #include "NAVisitor.cpp"
@@ -16,6 +16,9 @@ extern "C" {
     SEXP row_infs(SEXP metadata, SEXP data, SEXP output, SEXP extras);
     SEXP row_means(SEXP metadata, SEXP data, SEXP output, SEXP extras);
     SEXP row_nas(SEXP metadata, SEXP data, SEXP output, SEXP extras);
+
+    // internal
+    SEXP num_tasks(SEXP num_rows, SEXP row_cost, SEXP num_workers);
 }
 
 } // namespace wiserow
@@ -3,10 +3,16 @@
 #include <stdexcept> // logic_error
 #include <string>
 
-#include <boost/variant/get.hpp>
-
 namespace wiserow {
 
+// what LevelTable stores for each level
+enum LevelFlag : unsigned char {
+    LEVEL_NA = 1,
+    LEVEL_MATCH = 2
+};
+
+// -------------------------------------------------------------------------------------------------
+
 struct target_traits {
     bool is_na;
     char* char_target;
@@ -41,13 +47,15 @@ target_traits get_target_traits(const SEXP& target) {
 
 // -------------------------------------------------------------------------------------------------
 
-CompBasedWorker::CompBasedWorker(const OperationMetadata& metadata,
-                                 const ColumnCollection& cc,
-                                 OutputWrapper<int>& ans,
-                                 const SEXP& comp_op,
-                                 const Rcpp::List& target_vals,
-                                 const std::shared_ptr<OutputStrategy<int>>& out_strategy)
+template<typename Strategy, typename Sink>
+CompBasedWorker<Strategy, Sink>::CompBasedWorker(const OperationMetadata& metadata,
+                                                 const ColumnCollection& cc,
+                                                 Sink& ans,
+                                                 const SEXP& comp_op,
+                                                 const Rcpp::List& target_vals,
+                                                 const std::shared_ptr<Strategy>& out_strategy)
     : ParallelWorker(metadata, cc)
+    , is_na_(BooleanVisitorBuilder().is_na().compile())
     , ans_(ans)
     , comp_op_(parse_comp_op(Rcpp::as<std::string>(comp_op)))
     , out_strategy_(out_strategy)
@@ -57,31 +65,58 @@ CompBasedWorker::CompBasedWorker(const OperationMetadata& metadata,
         throw std::logic_error("Output strategy cannot be null.");
     } // nocov end
 
+    ans_.validate(num_ops(), 1);
+
     for (R_xlen_t i = 0; i < target_vals.length(); i++) {
         target_traits tt = get_target_traits(target_vals[i]);
-        visitors_.push_back(BooleanVisitorBuilder().compare(comp_op_, target_vals[i]).build());
+        predicates_.push_back(BooleanVisitorBuilder().compare(comp_op_, target_vals[i]).compile());
         na_targets_.push_back(tt.is_na);
+        any_complex_target_ = any_complex_target_ || TYPEOF(target_vals[i]) == CPLXSXP;
         char_targets_.push_back(tt.char_target);
+
+        charsxp_targets_.push_back(CharsxpSet());
+        if (tt.char_target && (comp_op_ == CompOp::EQ || comp_op_ == CompOp::NEQ)) {
+            SEXP target = target_vals[i];
+            charsxp_targets_.back().insert(STRING_ELT(target, 0));
+        }
+    }
+
+    if (predicates_.empty()) return;
+
+    // factor columns are compared once per level, rows then only look their codes up
+    level_tables_.resize(cc.ncol());
+    for (std::size_t j = 0; j < cc.ncol(); j++) {
+        const ColumnSpan& span = cc.span(j);
+        if (span.type() != ColumnType::FACTOR) continue;
+
+        const BooleanPredicate& predicate = predicates_[j % predicates_.size()];
+        level_tables_[j] = LevelTable(span.as_factor(), [&](SEXP level) {
+            boost::string_ref str_ref = visitable(level);
+            return (is_na_(str_ref) ? LEVEL_NA : 0) | (predicate(str_ref) ? LEVEL_MATCH : 0);
+        });
     }
 }
 
 // -------------------------------------------------------------------------------------------------
 
-ParallelWorker::thread_local_ptr CompBasedWorker::work_row(std::size_t in_id, std::size_t out_id, thread_local_ptr t_local) {
+template<typename Strategy, typename Sink>
+void CompBasedWorker<Strategy, Sink>::work_row(std::size_t in_id, std::size_t out_id, WorkerScratch& scratch) {
     bool any_na = false;
-    std::shared_ptr<OutputStrategy<int>> thread_local_strategy =
-        t_local ? std::static_pointer_cast<OutputStrategy<int>>(t_local) : out_strategy_->clone();
+    Strategy *thread_local_strategy = scratch.clone_of(out_strategy_);
 
     thread_local_strategy->reinit();
 
     for (std::size_t j = 0; j < col_collection_.ncol(); j++) {
-        auto visitor = visitors_[j % visitors_.size()];
+        const BooleanPredicate& predicate = predicates_[j % predicates_.size()];
         bool na_target = na_targets_[j % na_targets_.size()];
         const char *char_target = char_targets_[j % char_targets_.size()];
-        supported_col_t variant = col_collection_(in_id, j);
+        const ColumnSpan& span = col_collection_.span(j);
+
+        bool is_factor = span.type() == ColumnType::FACTOR;
+        unsigned char level = is_factor ? level_tables_[j][span.as_factor().codes()[in_id]] : 0;
 
         if (!na_target) {
-            bool is_na = boost::apply_visitor(na_visitor_, variant);
+            bool is_na = is_factor ? (level & LEVEL_NA) : col_collection_.visit(in_id, j, is_na_);
             if (is_na) {
                 if (metadata.na_action == NaAction::PASS) any_na = true;
                 continue;
@@ -93,14 +128,20 @@ ParallelWorker::thread_local_ptr CompBasedWorker::work_row(std::size_t in_id, st
             continue;
         }
 
-        if (char_target && col_collection_[j]->is_logical()) {
+        if (is_factor) {
+            thread_local_strategy->apply(j, (level & LEVEL_MATCH) != 0);
+        }
+        else if (char_target && span.is_logical()) {
             // tricky case when source is R-logical (with underlying int) that should be converted to string
-            bool variant_bool = boost::get<int>(variant) != 0;
+            bool variant_bool = span.as<int>()[in_id] != 0;
             boost::string_ref str_ref(char_target);
-            thread_local_strategy->apply(j, variant, comp_operator_.apply(variant_bool, str_ref));
+            thread_local_strategy->apply(j, comp_operator_.apply(variant_bool, str_ref));
+        }
+        else if (span.type() == ColumnType::STRING) {
+            thread_local_strategy->apply(j, compare(span.as<SEXP>()[in_id], j, predicate, nullptr));
         }
         else {
-            thread_local_strategy->apply(j, variant, boost::apply_visitor(*visitor, variant));
+            thread_local_strategy->apply(j, col_collection_.visit(in_id, j, predicate));
         }
 
         if (thread_local_strategy->short_circuit()) {
@@ -108,8 +149,229 @@ ParallelWorker::thread_local_ptr CompBasedWorker::work_row(std::size_t in_id, st
         }
     }
 
-    ans_[out_id] = thread_local_strategy->output(metadata, col_collection_.ncol(), any_na);
-    return thread_local_strategy;
+    ans_.at(out_id, 0) = thread_local_strategy->output(metadata, col_collection_.ncol(), any_na);
+}
+
+// -------------------------------------------------------------------------------------------------
+
+template<typename Strategy, typename Sink>
+template<typename T>
+bool CompBasedWorker<Strategy, Sink>::compare(const T& val, const std::size_t, const BooleanPredicate& predicate, const char *) const {
+    return predicate(visitable(val));
+}
+
+template<typename Strategy, typename Sink>
+bool CompBasedWorker<Strategy, Sink>::compare(const SEXP& val, const std::size_t j, const BooleanPredicate& predicate, const char *) const {
+    const CharsxpSet& target = charsxp_targets_[j % charsxp_targets_.size()];
+
+    if (!target.empty()) {
+        CharIdentity identity = target.find(val);
+        if (identity != CharIdentity::UNKNOWN) {
+            return (identity == CharIdentity::SAME) == (comp_op_ == CompOp::EQ);
+        }
+    }
+
+    return predicate(visitable(val));
+}
+
+template<typename Strategy, typename Sink>
+bool CompBasedWorker<Strategy, Sink>::compare(const int& val, const std::size_t, const BooleanPredicate& predicate, const char *logical_vs_char_target) const {
+    if (logical_vs_char_target) {
+        // tricky case when source is R-logical (with underlying int) that should be converted to string
+        return comp_operator_.apply(val != 0, boost::string_ref(logical_vs_char_target));
+    }
+    else {
+        return predicate(val);
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+
+template<typename Strategy, typename Sink>
+bool CompBasedWorker<Strategy, Sink>::na_result(const std::size_t j, const RowBlock& block, scratch_vector<MatchTally>& tallies) const {
+    bool na_target = na_targets_[j % na_targets_.size()];
+
+    if (na_target && comp_op_ != CompOp::EQ && comp_op_ != CompOp::NEQ) {
+        // if target for comparison is NA but operator is not one of [==, !=], result is NA
+        for (std::size_t r = 0; r < block.size; r++) {
+            if (!out_strategy_->short_circuit(tallies[r])) tallies[r].any_na = true;
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+// -------------------------------------------------------------------------------------------------
+
+template<typename Strategy, typename Sink>
+template<typename Column>
+void CompBasedWorker<Strategy, Sink>::compare_column(const Column& column,
+                                                     const std::size_t j,
+                                                     const RowBlock& block,
+                                                     scratch_vector<MatchTally>& tallies,
+                                                     const char *logical_vs_char_target) const
+{
+    const BooleanPredicate& predicate = predicates_[j % predicates_.size()];
+    bool na_target = na_targets_[j % na_targets_.size()];
+
+    if (na_result(j, block, tallies)) return;
+
+    for (std::size_t r = 0; r < block.size; r++) {
+        MatchTally& tally = tallies[r];
+        if (out_strategy_->short_circuit(tally)) continue;
+
+        const typename Column::value_type& val = column[block.in_ids[r]];
+
+        if (!na_target && is_na_(visitable(val))) {
+            if (metadata.na_action == NaAction::PASS) tally.any_na = true;
+            continue;
+        }
+
+        tally.apply(j, compare(val, j, predicate, logical_vs_char_target));
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+
+template<typename Strategy, typename Sink>
+void CompBasedWorker<Strategy, Sink>::compare_column(const FactorColumn& column,
+                                                     const std::size_t j,
+                                                     const RowBlock& block,
+                                                     scratch_vector<MatchTally>& tallies,
+                                                     const char *) const
+{
+    const LevelTable& levels = level_tables_[j];
+    const int *codes = column.codes();
+    bool na_target = na_targets_[j % na_targets_.size()];
+
+    if (na_result(j, block, tallies)) return;
+
+    for (std::size_t r = 0; r < block.size; r++) {
+        MatchTally& tally = tallies[r];
+        if (out_strategy_->short_circuit(tally)) continue;
+
+        unsigned char level = levels[codes[block.in_ids[r]]];
+
+        if (!na_target && (level & LEVEL_NA)) {
+            if (metadata.na_action == NaAction::PASS) tally.any_na = true;
+            continue;
+        }
+
+        tally.apply(j, (level & LEVEL_MATCH) != 0);
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+
+template<typename Strategy, typename Sink>
+void CompBasedWorker<Strategy, Sink>::work_block(const RowBlock& block, WorkerScratch& scratch) {
+    TallyBuffer& buffer = scratch.state<TallyBuffer>();
+
+    buffer.reset(block.size);
+    compare_columns(block, 0, col_collection_.ncol(), buffer.tallies);
+    write_block(block, buffer);
+}
+
+// complex numbers can't be ordered, and a row that short-circuits must not reach the error in a later slab
+template<typename Strategy, typename Sink>
+bool CompBasedWorker<Strategy, Sink>::supports_column_split() const {
+    if (comp_op_ == CompOp::EQ || comp_op_ == CompOp::NEQ) return true;
+    if (any_complex_target_) return false;
+
+    for (std::size_t j = 0; j < col_collection_.ncol(); j++) {
+        if (col_collection_.span(j).type() == ColumnType::COMPLEX) return false;
+    }
+
+    return true;
+}
+
+template<typename Strategy, typename Sink>
+WorkerThreadLocal *CompBasedWorker<Strategy, Sink>::scan_slab(const RowBlock& block,
+                                                              const std::size_t j_begin,
+                                                              const std::size_t j_end,
+                                                              ScratchArena& arena)
+{
+    TallyBuffer *partial = arena.create<TallyBuffer>(arena);
+
+    partial->reset(block.size);
+    compare_columns(block, j_begin, j_end, partial->tallies);
+    return partial;
+}
+
+template<typename Strategy, typename Sink>
+void CompBasedWorker<Strategy, Sink>::merge_slabs(const RowBlock& block,
+                                                  WorkerThreadLocal * const *partials,
+                                                  const std::size_t num_slabs,
+                                                  WorkerScratch& scratch)
+{
+    TallyBuffer& buffer = scratch.state<TallyBuffer>();
+
+    buffer.reset(block.size);
+    buffer.merge(partials, num_slabs);
+    write_block(block, buffer);
+}
+
+template<typename Strategy, typename Sink>
+void CompBasedWorker<Strategy, Sink>::compare_columns(const RowBlock& block,
+                                                      const std::size_t j_begin,
+                                                      const std::size_t j_end,
+                                                      scratch_vector<MatchTally>& tallies) const
+{
+    for (std::size_t j = j_begin; j < j_end; j++) {
+        const ColumnSpan& span = col_collection_.span(j);
+
+        switch(span.type()) {
+        case ColumnType::INTEGER: {
+            const char *char_target = char_targets_[j % char_targets_.size()];
+            compare_column(span.as<int>(), j, block, tallies, span.is_logical() ? char_target : nullptr);
+            break;
+        }
+        case ColumnType::DOUBLE: {
+            compare_column(span.as<double>(), j, block, tallies, nullptr);
+            break;
+        }
+        case ColumnType::STRING: {
+            compare_column(span.as<SEXP>(), j, block, tallies, nullptr);
+            break;
+        }
+        case ColumnType::COMPLEX: {
+            compare_column(span.as<std::complex<double>>(), j, block, tallies, nullptr);
+            break;
+        }
+        case ColumnType::FACTOR: {
+            compare_column(span.as_factor(), j, block, tallies, nullptr);
+            break;
+        }
+        }
+    }
+}
+
+template<typename Strategy, typename Sink>
+void CompBasedWorker<Strategy, Sink>::write_block(const RowBlock& block, const TallyBuffer& buffer) {
+    const Strategy& strategy = *out_strategy_;
+    const OperationMetadata& block_metadata = metadata;
+    const std::size_t ncol = col_collection_.ncol();
+    const MatchTally *tallies = buffer.tallies.data();
+
+    auto value = [&](const std::size_t r) {
+        return strategy.output(block_metadata, ncol, tallies[r]);
+    };
+
+    if (block.out_ids) {
+        for (std::size_t r = 0; r < block.size; r++) {
+            ans_.at(block.out_ids[r], 0) = value(r);
+        }
+        return;
+    }
+
+    ans_.fill_block(block.out_begin, 0, block.size, value);
 }
 
+// =================================================================================================
+// the strategies mixed_out.cpp dispatches to
+
+WISEROW_INSTANTIATE_MATCH_TYPES(CompBasedWorker);
+
 } // namespace wiserow
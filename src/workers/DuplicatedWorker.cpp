@@ -1,76 +1,95 @@
 #include "integer-workers.h"
 
-#include <boost/variant/get.hpp>
+#include <type_traits> // is_same
 
 namespace wiserow {
 
-DuplicatedWorker::DuplicatedWorker(const OperationMetadata& metadata,
-                                   const ColumnCollection& cc,
-                                   OutputWrapper<int>& ans,
-                                   const std::shared_ptr<OutputStrategy<int>>& out_strategy)
+template<typename Strategy, typename Sink>
+DuplicatedWorker<Strategy, Sink>::DuplicatedWorker(const OperationMetadata& metadata,
+                                                   const ColumnCollection& cc,
+                                                   Sink& ans,
+                                                   const std::shared_ptr<Strategy>& out_strategy)
     : ParallelWorker(metadata, cc)
     , ans_(ans)
     , out_strategy_(out_strategy)
-{ }
+{
+    bool identity = std::is_same<Strategy, IdentityStrategy>::value;
+    ans_.validate(num_ops(), identity ? cc.ncol() : 1);
+}
+
+// strings go through their CHARSXPs, see DuplicatedVisitor
+template<typename Strategy, typename Sink>
+template<typename Row>
+bool DuplicatedWorker<Strategy, Sink>::visit(const Row& row, const std::size_t j, DuplicatedVisitor& visitor) const {
+    const ColumnSpan& span = col_collection_.span(j);
+
+    switch(span.type()) {
+    case ColumnType::STRING:
+        return visitor(row.string(j));
+    case ColumnType::FACTOR:
+        return visitor(span.as_factor().level(row.code(j)));
+    case ColumnType::DOUBLE:
+        return visitor(row.real(j));
+    case ColumnType::COMPLEX:
+        return visitor(row.complex(j));
+    case ColumnType::INTEGER:
+        break;
+    }
+
+    int variant_int = row.integer(j);
 
-ParallelWorker::thread_local_ptr DuplicatedWorker::work_row(std::size_t in_id, std::size_t out_id, thread_local_ptr t_local) {
-    std::shared_ptr<OutputStrategy<int>> thread_local_strategy =
-        t_local ? std::static_pointer_cast<OutputStrategy<int>>(t_local) : out_strategy_->clone();
+    if (span.is_logical() && variant_int != NA_INTEGER) {
+        bool int_bool = static_cast<bool>(variant_int);
+        return visitor(int_bool);
+    }
+
+    return visitor(variant_int);
+}
+
+template<typename Strategy, typename Sink>
+void DuplicatedWorker<Strategy, Sink>::work_row(std::size_t in_id, std::size_t out_id, WorkerScratch& scratch) {
+    work_cells(ColumnRow(col_collection_, in_id), out_id, scratch);
+}
 
-    DuplicatedVisitor duplicated_visitor;
+template<typename Strategy, typename Sink>
+void DuplicatedWorker<Strategy, Sink>::work_tile_row(const TileRow& row, std::size_t out_id, WorkerScratch& scratch) {
+    work_cells(row, out_id, scratch);
+}
 
-    if (thread_local_strategy) {
-        thread_local_strategy->reinit();
+template<typename Strategy, typename Sink>
+template<typename Row>
+void DuplicatedWorker<Strategy, Sink>::work_cells(const Row& row, const std::size_t out_id, WorkerScratch& scratch) {
+    DuplicatedVisitor& duplicated_visitor = scratch.state<DuplicatedBuffer>().visitor;
+    duplicated_visitor.reset(col_collection_.ncol());
 
+    if (std::is_same<Strategy, IdentityStrategy>::value) {
         for (std::size_t j = 0; j < col_collection_.ncol(); j++) {
-            supported_col_t variant = col_collection_(in_id, j);
-
-            if (col_collection_[j]->is_logical()) {
-                int variant_int = boost::get<int>(variant);
-
-                if (variant_int == NA_INTEGER) {
-                    thread_local_strategy->apply(j, variant, boost::apply_visitor(duplicated_visitor, variant));
-                }
-                else {
-                    bool int_bool = static_cast<bool>(variant_int);
-                    thread_local_strategy->apply(j, variant, (duplicated_visitor)(int_bool));
-                }
-            }
-            else {
-                thread_local_strategy->apply(j, variant, boost::apply_visitor(duplicated_visitor, variant));
-            }
-
-            if (thread_local_strategy->short_circuit()) {
-                break;
-            }
+            ans_.at(out_id, j) = visit(row, j, duplicated_visitor);
         }
 
-        ans_[out_id] = thread_local_strategy->output(metadata, col_collection_.ncol(), false);
-        return thread_local_strategy;
+        return;
     }
-    else {
-        // thread_local_strategy is null -> IdentityStrategy
-        for (std::size_t j = 0; j < col_collection_.ncol(); j++) {
-            supported_col_t variant = col_collection_(in_id, j);
-
-            if (col_collection_[j]->is_logical()) {
-                int variant_int = boost::get<int>(variant);
-
-                if (variant_int == NA_INTEGER) {
-                    ans_(out_id, j) = boost::apply_visitor(duplicated_visitor, variant);
-                }
-                else {
-                    bool int_bool = static_cast<bool>(variant_int);
-                    ans_(out_id, j) = (duplicated_visitor)(int_bool);
-                }
-            }
-            else {
-                ans_(out_id, j) = boost::apply_visitor(duplicated_visitor, variant);
-            }
-        }
 
-        return nullptr;
+    Strategy *thread_local_strategy = scratch.clone_of(out_strategy_);
+
+    thread_local_strategy->reinit();
+
+    for (std::size_t j = 0; j < col_collection_.ncol(); j++) {
+        thread_local_strategy->apply(j, visit(row, j, duplicated_visitor));
+
+        if (thread_local_strategy->short_circuit()) {
+            break;
+        }
     }
+
+    ans_.at(out_id, 0) = thread_local_strategy->output(metadata, col_collection_.ncol(), false);
 }
 
+// =================================================================================================
+// the strategies mixed_out.cpp dispatches to
+
+template class DuplicatedWorker<IdentityStrategy, LogicalDataFrameSink>;
+template class DuplicatedWorker<IdentityStrategy, LogicalMatrixSink>;
+WISEROW_INSTANTIATE_MATCH_TYPES(DuplicatedWorker);
+
 } // namespace wiserow
@@ -1,65 +1,106 @@
 #include "integer-workers.h"
 
 #include <stdexcept> // logic_error
-#include <string>
-
-#include <boost/variant/get.hpp>
 
 namespace wiserow {
 
-InSetWorker::InSetWorker(const OperationMetadata& metadata,
-                         const ColumnCollection& cc,
-                         OutputWrapper<int>& ans,
-                         const Rcpp::List& target_sets,
-                         const bool negate,
-                         const std::shared_ptr<OutputStrategy<int>>& out_strategy)
+template<typename Strategy, typename Sink>
+InSetWorker<Strategy, Sink>::InSetWorker(const OperationMetadata& metadata,
+                                         const ColumnCollection& cc,
+                                         Sink& ans,
+                                         const Rcpp::List& target_sets,
+                                         const bool negate,
+                                         const std::shared_ptr<Strategy>& out_strategy)
     : ParallelWorker(metadata, cc)
     , ans_(ans)
+    , negate_(negate)
     , out_strategy_(out_strategy)
 {
     if (!out_strategy_) { // nocov start
         throw std::logic_error("Output strategy cannot be null.");
     } // nocov end
 
+    ans_.validate(num_ops(), 1);
+
     for (R_xlen_t i = 0; i < target_sets.length(); i++) {
-        visitors_.push_back(BooleanVisitorBuilder().in_set(target_sets[i], negate).build());
-        char_targets_.push_back(TYPEOF(target_sets[i]) == STRSXP);
+        target_sets_.push_back(TargetSet(target_sets[i]));
+    }
+
+    if (target_sets_.empty()) return;
+
+    // set membership of factor columns is checked once per level
+    level_tables_.resize(cc.ncol());
+    for (std::size_t j = 0; j < cc.ncol(); j++) {
+        const ColumnSpan& span = cc.span(j);
+        if (span.type() != ColumnType::FACTOR) continue;
+
+        const TargetSet& targets = target_sets_[j % target_sets_.size()];
+        level_tables_[j] = LevelTable(span.as_factor(), [&](SEXP level) {
+            return targets.contains(level);
+        });
     }
 }
 
-ParallelWorker::thread_local_ptr InSetWorker::work_row(std::size_t in_id, std::size_t out_id, thread_local_ptr t_local) {
-    std::shared_ptr<OutputStrategy<int>> thread_local_strategy =
-        t_local ? std::static_pointer_cast<OutputStrategy<int>>(t_local) : out_strategy_->clone();
+template<typename Strategy, typename Sink>
+void InSetWorker<Strategy, Sink>::work_row(std::size_t in_id, std::size_t out_id, WorkerScratch& scratch) {
+    work_cells(ColumnRow(col_collection_, in_id), out_id, scratch);
+}
+
+template<typename Strategy, typename Sink>
+void InSetWorker<Strategy, Sink>::work_tile_row(const TileRow& row, std::size_t out_id, WorkerScratch& scratch) {
+    work_cells(row, out_id, scratch);
+}
+
+template<typename Strategy, typename Sink>
+template<typename Row>
+void InSetWorker<Strategy, Sink>::work_cells(const Row& row, const std::size_t out_id, WorkerScratch& scratch) {
+    Strategy *thread_local_strategy = scratch.clone_of(out_strategy_);
 
     thread_local_strategy->reinit();
 
     for (std::size_t j = 0; j < col_collection_.ncol(); j++) {
-        auto visitor = visitors_[j % visitors_.size()];
-        supported_col_t variant = col_collection_(in_id, j);
-
-        if (char_targets_[j % char_targets_.size()] && col_collection_[j]->is_logical()) {
-            // tricky case when source is R-logical (with underlying int) that should be converted to string
-            int variant_int = boost::get<int>(variant);
-            if (variant_int == NA_INTEGER) {
-                thread_local_strategy->apply(j, variant, boost::apply_visitor(*visitor, variant));
-            }
-            else {
-                const char *int_char = variant_int == 0 ? "FALSE" : "TRUE";
-                boost::string_ref str_ref(int_char);
-                thread_local_strategy->apply(j, variant, (*visitor)(str_ref));
-            }
+        const TargetSet& targets = target_sets_[j % target_sets_.size()];
+        const ColumnSpan& span = col_collection_.span(j);
+        bool ans = false;
+
+        switch(span.type()) {
+        case ColumnType::INTEGER: {
+            int val = row.integer(j);
+            // R-logicals look like "TRUE" or "FALSE" to string targets
+            ans = span.is_logical() && targets.is_string() ? targets.contains_logical(val) : targets.contains(val);
+            break;
         }
-        else {
-            thread_local_strategy->apply(j, variant, boost::apply_visitor(*visitor, variant));
+        case ColumnType::DOUBLE: {
+            ans = targets.contains(row.real(j));
+            break;
+        }
+        case ColumnType::COMPLEX: {
+            ans = targets.contains(row.complex(j));
+            break;
         }
+        case ColumnType::STRING: {
+            ans = targets.contains(row.string(j));
+            break;
+        }
+        case ColumnType::FACTOR: {
+            ans = level_tables_[j][row.code(j)] != 0;
+            break;
+        }
+        }
+
+        thread_local_strategy->apply(j, !targets.empty() && ans != negate_);
 
         if (thread_local_strategy->short_circuit()) {
             break;
         }
     }
 
-    ans_[out_id] = thread_local_strategy->output(metadata, col_collection_.ncol(), false);
-    return thread_local_strategy;
+    ans_.at(out_id, 0) = thread_local_strategy->output(metadata, col_collection_.ncol(), false);
 }
 
+// =================================================================================================
+// the strategies mixed_out.cpp dispatches to
+
+WISEROW_INSTANTIATE_MATCH_TYPES(InSetWorker);
+
 } // namespace wiserow
@@ -2,6 +2,7 @@
 #define WISEROW_GENERICWORKERS_H_
 
 #include <cstddef> // size_t
+#include <functional> // greater, less...
 #include <memory>
 #include <stdexcept> // runtime_error
 #include <string>
@@ -25,332 +26,848 @@ namespace wiserow {
 
 // =================================================================================================
 
-template<typename T>
+// what RowArithWorker and RowMeansWorker are specialized on, chosen once in visit_into_numeric
+template<bool PASS_NA, bool CUMULATIVE, bool LOGICAL>
+struct ArithMode
+{
+    static const bool pass_na = PASS_NA;       // na_action = pass
+    static const bool cumulative = CUMULATIVE;
+    static const bool logical = LOGICAL;       // output_mode = logical
+};
+
+// -------------------------------------------------------------------------------------------------
+
+// Sink is one of the concrete output wrappers, so that writes are not virtual
+template<typename T, typename Sink, typename Mode>
 class RowArithWorker : public ParallelWorker
 {
 public:
     RowArithWorker(const OperationMetadata& metadata,
                    const ColumnCollection& cc,
-                   OutputWrapper<T>& ans,
+                   Sink& ans,
                    const Rcpp::List extras)
         : ParallelWorker(metadata, cc)
-        , cumulative_(Rcpp::as<bool>(extras["cumulative"]))
         , ans_(ans)
         , arith_opr_(parse_arith_op(Rcpp::as<std::string>(extras["arith_op"])))
-    { }
-
-    virtual thread_local_ptr work_row(std::size_t in_id, std::size_t out_id, thread_local_ptr t_local) override {
-        bool need_init = arith_opr_.arith_op != ArithOp::ADD;
+    {
+        ans_.validate(num_ops(), output_ncol());
+    }
 
-        for (std::size_t j = 0; j < col_collection_.ncol(); j++) {
-            bool is_na = boost::apply_visitor(na_visitor_, col_collection_(in_id, j));
+    virtual void work_row(std::size_t in_id, std::size_t out_id, WorkerScratch&) override {
+        accumulate_row<false>(in_id, out_id);
+    }
 
-            if (is_na) {
-                if (metadata.na_action == NaAction::PASS) {
-                    if (cumulative_) {
-                        for (std::size_t k = j; k < col_collection_.ncol(); k++) {
-                            ans_(out_id, k) = na_value_;
+protected:
+    /*
+     * The accumulator is kept in a local and only what the output should have is written. With
+     * MEANS, cumulative sums are divided by the number of values seen so far as they are written.
+     * Returns how many non-NA values were accumulated.
+     */
+    template<bool MEANS>
+    int accumulate_row(const std::size_t in_id, const std::size_t out_id) {
+        const std::size_t ncol = col_collection_.ncol();
+        int n = 0;
+
+        if (ncol > 0) {
+            // this is what the first operation reads
+            T acc = ans_.at(out_id, 0);
+            bool need_init = arith_opr_.arith_op != ArithOp::ADD;
+            bool na_found = false;
+
+            for (std::size_t j = 0; j < ncol; j++) {
+                if (col_collection_.visit(in_id, j, na_visitor_)) {
+                    if (Mode::pass_na) {
+                        for (std::size_t k = Mode::cumulative ? j : 0; k < (Mode::cumulative ? ncol : 1); k++) {
+                            ans_.at(out_id, k) = na_value_;
                         }
-                    }
-                    else {
-                        ans_[out_id] = na_value_;
-                    }
 
-                    break;
+                        na_found = true;
+                        break;
+                    }
                 }
-                else if (cumulative_) {
-                    ans_(out_id, j) = ans_(out_id, j > 0 ? j - 1 : 0);
+                else {
+                    const T val = col_collection_.visit(in_id, j, visitor_);
+                    acc = need_init ? val : arith_opr_.apply(acc, val);
+                    need_init = false;
+                    n++;
+                }
+
+                if (Mode::cumulative) {
+                    T& ans = ans_.at(out_id, j);
+                    ans = acc;
+                    if (MEANS && !Mode::logical && n > 0) ans /= static_cast<double>(n);
                 }
             }
-            else if (need_init) {
-                need_init = false;
-                supported_col_t variant = col_collection_(in_id, j);
-                ans_(out_id, cumulative_ ? j : 0) = boost::apply_visitor(visitor_, variant);
-                // this branch will never be reached from RowMeansWorker
+
+            if (!Mode::cumulative && !na_found) {
+                ans_.at(out_id, 0) = acc;
             }
-            else {
-                supported_col_t variant = col_collection_(in_id, j);
-                const T val = boost::apply_visitor(visitor_, variant);
-                std::size_t prev_j = cumulative_ ? (j > 0 ? j - 1 : 0) : 0;
-                ans_(out_id, cumulative_ ? j : 0) = arith_opr_.apply(ans_(out_id, prev_j), val);
-
-                // for RowMeansWorker
-                if (t_local) {
-                    std::static_pointer_cast<CountStrategy>(t_local)->apply(0, variant, true);
-                }
+        }
+
+        coerce_logical(out_id);
+        return n;
+    }
+
+    // per-row accumulators of a block in column-at-a-time mode
+    class BlockState : public WorkerThreadLocal
+    {
+    public:
+        BlockState(ScratchArena& arena)
+            : acc(arena)
+            , counts(arena)
+            , flags(arena)
+        { }
+
+        Accumulators<T> accumulators() {
+            return { acc.data(), counts.data(), flags.data() };
+        }
+
+        scratch_vector<T> acc;
+        scratch_vector<int> counts;
+        scratch_vector<unsigned char> flags;
+    };
+
+    virtual bool supports_blocks() const override { return true; }
+
+    // numeric columns go through the vectorized kernels, so e.g. tall matrices with few columns use them too
+    virtual bool narrow_blocks() const override {
+        for (std::size_t j = 0; j < col_collection_.ncol(); j++) {
+            ColumnType type = col_collection_.span(j).type();
+            if (type != ColumnType::INTEGER && type != ColumnType::DOUBLE) return false;
+        }
+
+        return true;
+    }
+
+    virtual void work_block(const RowBlock& block, WorkerScratch& scratch) override {
+        accumulate_block<false>(block, scratch.state<BlockState>());
+    }
+
+    // like accumulate_row, cumulative columns are written (and divided with MEANS) right after they are accumulated
+    template<bool MEANS>
+    void accumulate_block(const RowBlock& block, BlockState& state) {
+        init_block(block, state);
+
+        if (Mode::cumulative) {
+            for (std::size_t j = 0; j < col_collection_.ncol(); j++) {
+                accumulate_columns(block, j, j + 1, state);
+                write_block<MEANS>(block, j, state);
             }
         }
+        else {
+            accumulate_columns(block, 0, col_collection_.ncol(), state);
+        }
 
-        // any int > 1 is not really TRUE for R
-        if (metadata.output_mode == LGLSXP) {
-            std::size_t max_j = cumulative_ ? col_collection_.ncol() : 1;
-            for (std::size_t j = 0; j < max_j; j++) {
-                T ans = ans_(out_id, j);
-                if (ans != na_value_ && ans != 0.0) { // double can be cast to complex, int can't
-                    ans_(out_id, j) = 1;
+        finish_block(block, state);
+    }
+
+    /*
+     * Partial sums can be added, and only the non-NA counts of later columns matter for means.
+     * Strings and factors throw, but only once a row reaches them, which a row with NA doesn't if na_action = pass.
+     */
+    virtual bool supports_column_split() const override {
+        if (Mode::cumulative || arith_opr_.arith_op != ArithOp::ADD) return false;
+
+        for (std::size_t j = 0; j < col_collection_.ncol(); j++) {
+            ColumnType type = col_collection_.span(j).type();
+            if (type == ColumnType::STRING || type == ColumnType::FACTOR) return false;
+        }
+
+        return true;
+    }
+
+    virtual WorkerThreadLocal *scan_slab(const RowBlock& block,
+                                         const std::size_t j_begin,
+                                         const std::size_t j_end,
+                                         ScratchArena& arena) override
+    {
+        BlockState *partial = arena.create<BlockState>(arena);
+
+        partial->acc.assign(block.size, T(0));
+        partial->counts.assign(block.size, 0);
+        partial->flags.assign(block.size, 0);
+
+        accumulate_columns(block, j_begin, j_end, *partial);
+        return partial;
+    }
+
+    virtual void merge_slabs(const RowBlock& block,
+                             WorkerThreadLocal * const *partials,
+                             const std::size_t num_slabs,
+                             WorkerScratch& scratch) override
+    {
+        BlockState& state = scratch.state<BlockState>();
+        init_block(block, state);
+
+        for (std::size_t s = 0; s < num_slabs; s++) {
+            const BlockState& partial = *static_cast<const BlockState *>(partials[s]);
+
+            for (std::size_t r = 0; r < block.size; r++) {
+                unsigned char flags = partial.flags[r];
+
+                if (flags & ACC_NA_FOUND) {
+                    state.flags[r] |= ACC_NA_FOUND;
+                }
+                else if (flags & ACC_INITIALIZED) {
+                    state.acc[r] = arith_opr_.apply(state.acc[r], partial.acc[r]);
+                    state.counts[r] += partial.counts[r];
+                    state.flags[r] |= ACC_INITIALIZED;
                 }
             }
         }
 
-        return nullptr;
+        finish_block(block, state);
     }
-protected:
+
     RowArithWorker(const OperationMetadata& metadata,
                    const ColumnCollection& cc,
-                   OutputWrapper<T>& ans,
-                   const Rcpp::List extras,
+                   Sink& ans,
+                   const Rcpp::List,
                    ArithmeticOperator&& arith_opr)
         : ParallelWorker(metadata, cc)
-        , cumulative_(Rcpp::as<bool>(extras["cumulative"]))
         , ans_(ans)
         , arith_opr_(std::move(arith_opr))
-    { }
+    {
+        ans_.validate(num_ops(), output_ncol());
+    }
 
-    const bool cumulative_;
-    OutputWrapper<T>& ans_;
+    Sink& ans_;
 
     const T na_value_ = std::is_same<T, int>::value ? NA_INTEGER : NA_REAL;
     const NAVisitor na_visitor_;
 
 private:
+    void init_block(const RowBlock& block, BlockState& state) {
+        state.acc.resize(block.size);
+        state.counts.assign(block.size, 0);
+        state.flags.assign(block.size, 0);
+
+        for (std::size_t r = 0; r < block.size; r++) {
+            // this is what the first operation would read in row mode
+            state.acc[r] = ans_.at(block.out_id(r), 0);
+        }
+    }
+
+    void accumulate_columns(const RowBlock& block, const std::size_t j_begin, const std::size_t j_end, BlockState& state) {
+        for (std::size_t j = j_begin; j < j_end; j++) {
+            const ColumnSpan& span = col_collection_.span(j);
+
+            switch(span.type()) {
+            case ColumnType::INTEGER: {
+                accumulate_column(span.as<int>(), block, state);
+                break;
+            }
+            case ColumnType::DOUBLE: {
+                accumulate_column(span.as<double>(), block, state);
+                break;
+            }
+            case ColumnType::STRING: {
+                accumulate_column(span.as<SEXP>(), block, state);
+                break;
+            }
+            case ColumnType::COMPLEX: {
+                accumulate_column(span.as<std::complex<double>>(), block, state);
+                break;
+            }
+            case ColumnType::FACTOR: {
+                accumulate_column(span.as_factor(), block, state);
+                break;
+            }
+            }
+        }
+    }
+
+    void finish_block(const RowBlock& block, const BlockState& state) {
+        if (!Mode::cumulative) {
+            write_block<false>(block, 0, state);
+        }
+
+        for (std::size_t r = 0; r < block.size; r++) {
+            coerce_logical(block.out_id(r));
+        }
+    }
+
+    template<typename Column>
+    void accumulate_column(const Column& column, const RowBlock& block, BlockState& state) {
+        bool need_init = arith_opr_.arith_op != ArithOp::ADD;
+
+        if (block.contiguous && accumulate_contiguous(arith_opr_.arith_op, need_init, Mode::pass_na,
+                                                      contiguous_cells(column, block.in_ids[0]), block.size,
+                                                      state.accumulators()))
+        {
+            return;
+        }
+
+        for (std::size_t r = 0; r < block.size; r++) {
+            unsigned char& flags = state.flags[r];
+            if (flags & ACC_NA_FOUND) continue;
+
+            const typename Column::value_type& cell = column[block.in_ids[r]];
+
+            if (na_visitor_(visitable(cell))) {
+                if (Mode::pass_na) flags |= ACC_NA_FOUND;
+                continue;
+            }
+
+            const T val = visitor_(visitable(cell));
+            T& acc = state.acc[r];
+
+            if (need_init && !(flags & ACC_INITIALIZED)) {
+                acc = val;
+            }
+            else {
+                acc = arith_opr_.apply(acc, val);
+            }
+
+            flags |= ACC_INITIALIZED;
+            state.counts[r]++;
+        }
+    }
+
+    // how many output columns are written, without columns only coerce_logical touches the output
+    std::size_t output_ncol() const {
+        if (Mode::cumulative) return col_collection_.ncol();
+        return (col_collection_.ncol() > 0 || Mode::logical) ? 1 : 0;
+    }
+
+    // with MEANS, accumulators are divided by their non-NA counts
+    template<bool MEANS>
+    void write_block(const RowBlock& block, const std::size_t j, const BlockState& state) {
+        const T na_value = na_value_;
+        const T *acc = state.acc.data();
+        const int *counts = state.counts.data();
+        const unsigned char *flags = state.flags.data();
+
+        auto value = [=](const std::size_t r) -> T {
+            if (flags[r] & ACC_NA_FOUND) return na_value;
+            if (MEANS && !Mode::logical && counts[r] > 0) return acc[r] / static_cast<double>(counts[r]);
+            return acc[r];
+        };
+
+        if (block.out_ids) {
+            for (std::size_t r = 0; r < block.size; r++) {
+                ans_.at(block.out_ids[r], j) = value(r);
+            }
+            return;
+        }
+
+        ans_.fill_block(block.out_begin, j, block.size, value);
+    }
+
+    // any int > 1 is not really TRUE for R
+    void coerce_logical(const std::size_t out_id) {
+        if (Mode::logical) {
+            std::size_t max_j = Mode::cumulative ? col_collection_.ncol() : 1;
+            for (std::size_t j = 0; j < max_j; j++) {
+                T ans = ans_.at(out_id, j);
+                if (ans != na_value_ && ans != 0.0) { // double can be cast to complex, int can't
+                    ans_.at(out_id, j) = 1;
+                }
+            }
+        }
+    }
+
     const ArithmeticOperator arith_opr_;
     const NumericVisitor<T> visitor_;
 };
 
 // =================================================================================================
 
-template<typename T>
-class RowMeansWorker : public RowArithWorker<T>
+template<typename T, typename Sink, typename Mode>
+class RowMeansWorker : public RowArithWorker<T, Sink, Mode>
 {
 public:
     RowMeansWorker(const OperationMetadata& metadata,
                    const ColumnCollection& cc,
-                   OutputWrapper<T>& ans,
+                   Sink& ans,
                    Rcpp::List extras)
-        : RowArithWorker<T>(metadata, cc, ans, extras, ArithmeticOperator(ArithOp::ADD))
-        , non_na_counter_(std::make_shared<CountStrategy>())
-    { }
+        : RowArithWorker<T, Sink, Mode>(metadata, cc, ans, extras, ArithmeticOperator(ArithOp::ADD))
+    {
+        // divide_sum always writes the first column
+        if (!Mode::cumulative) ans.validate(this->num_ops(), 1);
+    }
 
-    virtual ParallelWorker::thread_local_ptr work_row(std::size_t in_id, std::size_t out_id, ParallelWorker::thread_local_ptr t_local) override {
-        std::shared_ptr<OutputStrategy<int>> thread_local_counter =
-            t_local ? std::static_pointer_cast<OutputStrategy<int>>(t_local) : non_na_counter_->clone();
+    // cumulative means are divided while accumulating, in one pass
+    virtual void work_row(std::size_t in_id, std::size_t out_id, WorkerScratch&) override {
+        int n = this->template accumulate_row<true>(in_id, out_id);
+        if (!Mode::cumulative) divide_sum(out_id, n);
+    }
 
-        thread_local_counter->reinit();
-        RowArithWorker<T>::work_row(in_id, out_id, thread_local_counter);
+protected:
+    typedef typename RowArithWorker<T, Sink, Mode>::BlockState BlockState;
 
-        if (this->cumulative_) {
-            double n = 0;
-            for (std::size_t j = 0; j < this->col_collection_.ncol(); j++) {
-                bool input_is_na = boost::apply_visitor(this->na_visitor_, this->col_collection_(in_id, j));
+    virtual void work_block(const RowBlock& block, WorkerScratch& scratch) override {
+        BlockState& state = scratch.state<BlockState>();
+        this->template accumulate_block<true>(block, state);
 
-                if (input_is_na) {
-                    if (this->metadata.na_action == NaAction::PASS) {
-                        break;
-                    }
-                }
-                else {
-                    n += 1;
-                }
+        if (!Mode::cumulative) {
+            for (std::size_t r = 0; r < block.size; r++) {
+                divide_sum(block.out_id(r), state.counts[r]);
+            }
+        }
+    }
 
-                if (n > 0 && this->metadata.output_mode != LGLSXP) {
-                    this->ans_(out_id, j) /= n;
-                }
+    virtual void merge_slabs(const RowBlock& block,
+                             WorkerThreadLocal * const *partials,
+                             const std::size_t num_slabs,
+                             WorkerScratch& scratch) override
+    {
+        RowArithWorker<T, Sink, Mode>::merge_slabs(block, partials, num_slabs, scratch);
+        BlockState& state = scratch.state<BlockState>();
+
+        for (std::size_t r = 0; r < block.size; r++) {
+            divide_sum(block.out_id(r), state.counts[r]);
+        }
+    }
+
+private:
+    void divide_sum(const std::size_t out_id, const double n) {
+        T ans = this->ans_.at(out_id, 0);
+        if (ans != this->na_value_) {
+            if (!(this->metadata.cols.is_null) && this->metadata.cols.len == 0) {
+                // corner case: no columns considered
+                this->ans_.at(out_id, 0) = std::is_integral<T>::value ? this->na_value_ : R_NaN;
+            }
+            else if (n == 0.0) {
+                // corner case: all values were NA
+                this->ans_.at(out_id, 0) = this->na_value_;
+            }
+            else if (!Mode::logical) {
+                this->ans_.at(out_id, 0) = ans / n;
             }
         }
+    }
+};
+
+// =================================================================================================
+
+// current extrema of each row in a block, the k-th extremum of row r is at k * block.size + r
+template<typename T>
+class ExtremaBuffer : public WorkerThreadLocal
+{
+public:
+    ExtremaBuffer(ScratchArena& arena)
+        : values(arena)
+        , which(arena)
+        , flags(arena)
+        , formatted(arena)
+    { }
+
+    void reset(const std::size_t size) {
+        values.resize(size);
+        which.assign(size, 0);
+        flags.assign(size, 0);
+        if (std::is_same<T, boost::string_ref>::value) formatted.resize(size);
+    }
+
+    Extrema<T> extrema(const CompOp comp_op, const std::size_t offset) {
+        return Extrema<T> { comp_op, values.data() + offset, which.data() + offset, flags.data() + offset };
+    }
+
+    scratch_vector<T> values;
+    scratch_vector<int> which;
+    scratch_vector<unsigned char> flags;
+    scratch_vector<NumberString> formatted; // only for strings, values can point here
+};
+
+// -------------------------------------------------------------------------------------------------
+// how cells become candidates for the extremum, logical output can only happen if all inputs are logical
+
+template<typename T>
+struct ExtremumCandidate
+{
+    static T from(const int val, const bool, NumberString&) {
+        return static_cast<T>(val);
+    }
+
+    static T from(const double val, const bool, NumberString&) {
+        return static_cast<T>(val);
+    }
+
+    static T from(SEXP, const bool, NumberString&) { // nocov start
+        throw std::runtime_error("[wiserow] Invalid type passed to RowExtremaWorker. This should not happen.");
+    } // nocov end
+
+    static void keep(ExtremaBuffer<T>& state, const std::size_t r, const T& val, const NumberString&) {
+        state.values[r] = val;
+    }
+};
+
+// numbers are compared as R would print them, strings in place
+template<>
+struct ExtremumCandidate<boost::string_ref>
+{
+    static boost::string_ref from(const int val, const bool is_logical, NumberString& buffer) {
+        buffer = is_logical ? NumberString(val != 0) : NumberString(val);
+        return buffer.str();
+    }
+
+    static boost::string_ref from(const double val, const bool, NumberString& buffer) {
+        buffer = NumberString(val);
+        return buffer.str();
+    }
+
+    static boost::string_ref from(SEXP val, const bool, NumberString&) {
+        return boost::string_ref(CHAR(val), LENGTH(val));
+    }
+
+    // buffer is reused by the next cell, so the row keeps its own copy
+    static void keep(ExtremaBuffer<boost::string_ref>& state,
+                     const std::size_t r,
+                     const boost::string_ref& val,
+                     const NumberString& buffer)
+    {
+        if (val.data() == buffer.str().data()) {
+            state.formatted[r] = buffer;
+            state.values[r] = state.formatted[r].str();
+        }
         else {
-            T ans = this->ans_(out_id, 0);
-            if (ans != this->na_value_) {
-                double n = thread_local_counter->output(this->metadata, 0, false);
+            state.values[r] = val;
+        }
+    }
+};
 
-                if (!(this->metadata.cols.is_null) && this->metadata.cols.len == 0) {
-                    // corner case: no columns considered
-                    this->ans_(out_id, 0) = std::is_integral<T>::value ? this->na_value_ : R_NaN;
-                }
-                else if (n == 0.0) {
-                    // corner case: all values were NA
-                    this->ans_(out_id, 0) = this->na_value_;
+// -------------------------------------------------------------------------------------------------
+
+/*
+ * Finds the extremum of each row with typed locals and no allocations, visiting a block of rows
+ * one column at a time (single rows are blocks of size 1). A cell replaces the current extremum if
+ * comp_op(cell, extremum) holds, so ties keep the first occurrence for < and >.
+ * If there are 2 comparison operators, both extrema are found in the same pass, e.g. for row_range.
+ *
+ * Contiguous numeric cells go through the vectorized kernels, see extrema_contiguous.
+ */
+template<typename T>
+class ExtremaWorker : public ParallelWorker
+{
+public:
+    std::size_t num_extrema() const {
+        return comp_ops_.size();
+    }
+
+protected:
+    ExtremaWorker(const OperationMetadata& metadata,
+                  const ColumnCollection& cc,
+                  const Rcpp::List extras)
+        : ParallelWorker(metadata, cc)
+    {
+        Rcpp::StringVector comp_ops(extras["comp_op"]);
+        for (R_xlen_t k = 0; k < comp_ops.length(); k++) {
+            comp_ops_.push_back(parse_comp_op(Rcpp::as<std::string>(comp_ops[k])));
+        }
+    }
+
+    virtual void work_row(std::size_t in_id, std::size_t out_id, WorkerScratch& scratch) override {
+        work_block({ out_id, 1, &in_id, true, nullptr }, scratch);
+    }
+
+    virtual bool supports_blocks() const override { return true; }
+
+    virtual void work_block(const RowBlock& block, WorkerScratch& scratch) override {
+        ExtremaBuffer<T>& state = scratch.state<ExtremaBuffer<T>>();
+        state.reset(block.size * comp_ops_.size());
+
+        scan_columns(block, 0, col_collection_.ncol(), state);
+        write_block(block, state, scratch);
+    }
+
+    // with == or != the extremum of one slab says nothing about the cells of the others
+    virtual bool supports_column_split() const override {
+        for (CompOp comp_op : comp_ops_) {
+            if (comp_op == CompOp::EQ || comp_op == CompOp::NEQ) return false;
+        }
+
+        return true;
+    }
+
+    virtual WorkerThreadLocal *scan_slab(const RowBlock& block,
+                                         const std::size_t j_begin,
+                                         const std::size_t j_end,
+                                         ScratchArena& arena) override
+    {
+        ExtremaBuffer<T> *partial = arena.create<ExtremaBuffer<T>>(arena);
+        partial->reset(block.size * comp_ops_.size());
+
+        scan_columns(block, j_begin, j_end, *partial);
+        return partial;
+    }
+
+    // later slabs replace the extremum under the same rule as later cells
+    virtual void merge_slabs(const RowBlock& block,
+                             WorkerThreadLocal * const *partials,
+                             const std::size_t num_slabs,
+                             WorkerScratch& scratch) override
+    {
+        ExtremaBuffer<T>& state = scratch.state<ExtremaBuffer<T>>();
+        state.reset(block.size * comp_ops_.size());
+
+        for (std::size_t slab = 0; slab < num_slabs; slab++) {
+            const ExtremaBuffer<T>& partial = *static_cast<const ExtremaBuffer<T> *>(partials[slab]);
+
+            for (std::size_t s = 0; s < state.flags.size(); s++) {
+                unsigned char& flags = state.flags[s];
+                if (flags & EXTREMUM_NA) continue;
+
+                if (partial.flags[s] & EXTREMUM_NA) {
+                    flags |= EXTREMUM_NA;
                 }
-                else if (this->metadata.output_mode != LGLSXP) {
-                    this->ans_(out_id, 0) = ans / n;
+                else if ((partial.flags[s] & EXTREMUM_FOUND) &&
+                         (!(flags & EXTREMUM_FOUND) || replaces(comp_ops_[s / block.size], partial.values[s], state.values[s])))
+                {
+                    if (partial.formatted.empty()) {
+                        state.values[s] = partial.values[s];
+                    }
+                    else {
+                        ExtremumCandidate<T>::keep(state, s, partial.values[s], partial.formatted[s]);
+                    }
+
+                    state.which[s] = partial.which[s];
+                    flags |= EXTREMUM_FOUND;
                 }
             }
         }
 
-        return thread_local_counter;
+        write_block(block, state, scratch);
     }
 
+    virtual void write_block(const RowBlock& block, const ExtremaBuffer<T>& state, WorkerScratch& scratch) = 0;
+
+    std::vector<CompOp> comp_ops_;
+
 private:
-    const std::shared_ptr<CountStrategy> non_na_counter_;
+    void scan_columns(const RowBlock& block, const std::size_t j_begin, const std::size_t j_end, ExtremaBuffer<T>& state) const {
+        for (std::size_t j = j_begin; j < j_end; j++) {
+            const ColumnSpan& span = col_collection_.span(j);
+
+            switch(span.type()) {
+            case ColumnType::INTEGER: {
+                scan_column(span.as<int>(), span.is_logical(), j, block, state);
+                break;
+            }
+            case ColumnType::DOUBLE: {
+                scan_column(span.as<double>(), false, j, block, state);
+                break;
+            }
+            case ColumnType::STRING: {
+                scan_column(span.as<SEXP>(), false, j, block, state);
+                break;
+            }
+            case ColumnType::FACTOR: {
+                scan_column(span.as_factor(), false, j, block, state);
+                break;
+            }
+            case ColumnType::COMPLEX: { // nocov start
+                throw std::runtime_error("[wiserow] Invalid type passed to RowExtremaWorker. This should not happen.");
+            } // nocov end
+            }
+        }
+    }
+
+    static bool replaces(const CompOp comp_op, const T& val, const T& extremum) {
+        switch(comp_op) {
+        case CompOp::LT:
+            return val < extremum;
+        case CompOp::LTE:
+            return val <= extremum;
+        case CompOp::GT:
+            return val > extremum;
+        case CompOp::GTE:
+            return val >= extremum;
+        default:
+            return false; // nocov
+        }
+    }
+
+    template<typename Column>
+    void scan_column(const Column& column,
+                     const bool is_logical,
+                     const std::size_t j,
+                     const RowBlock& block,
+                     ExtremaBuffer<T>& state) const
+    {
+        bool pass_na = metadata.na_action == NaAction::PASS;
+
+        if (block.contiguous) {
+            Extrema<T> first = state.extrema(comp_ops_[0], 0);
+            Extrema<T> second = comp_ops_.size() > 1 ? state.extrema(comp_ops_[1], block.size) : first;
+
+            if (extrema_contiguous(pass_na, static_cast<int>(j + 1),
+                                   contiguous_cells(column, block.in_ids[0]), block.size,
+                                   first, comp_ops_.size() > 1 ? &second : nullptr))
+            {
+                return;
+            }
+        }
+
+        for (std::size_t k = 0; k < comp_ops_.size(); k++) {
+            std::size_t offset = k * block.size;
+
+            switch(comp_ops_[k]) {
+            case CompOp::EQ:
+                scan_cells(column, is_logical, j, block, state, offset, std::equal_to<T>());
+                break;
+            case CompOp::NEQ:
+                scan_cells(column, is_logical, j, block, state, offset, std::not_equal_to<T>());
+                break;
+            case CompOp::LT:
+                scan_cells(column, is_logical, j, block, state, offset, std::less<T>());
+                break;
+            case CompOp::LTE:
+                scan_cells(column, is_logical, j, block, state, offset, std::less_equal<T>());
+                break;
+            case CompOp::GT:
+                scan_cells(column, is_logical, j, block, state, offset, std::greater<T>());
+                break;
+            case CompOp::GTE:
+                scan_cells(column, is_logical, j, block, state, offset, std::greater_equal<T>());
+                break;
+            }
+        }
+    }
+
+    template<typename Column, typename Compare>
+    void scan_cells(const Column& column,
+                    const bool is_logical,
+                    const std::size_t j,
+                    const RowBlock& block,
+                    ExtremaBuffer<T>& state,
+                    const std::size_t offset,
+                    const Compare& compare) const
+    {
+        bool pass_na = metadata.na_action == NaAction::PASS;
+        NumberString buffer;
+
+        for (std::size_t r = 0; r < block.size; r++) {
+            std::size_t s = offset + r;
+            unsigned char& flags = state.flags[s];
+            if (flags & EXTREMUM_NA) continue;
+
+            const typename Column::value_type& cell = column[block.in_ids[r]];
+
+            if (na_visitor_(visitable(cell))) {
+                if (pass_na) flags |= EXTREMUM_NA;
+                continue;
+            }
+
+            const T val = ExtremumCandidate<T>::from(cell, is_logical, buffer);
+
+            if (!(flags & EXTREMUM_FOUND) || compare(val, state.values[s])) {
+                ExtremumCandidate<T>::keep(state, s, val, buffer);
+                state.which[s] = static_cast<int>(j + 1);
+                flags |= EXTREMUM_FOUND;
+            }
+        }
+    }
+
+    const NAVisitor na_visitor_;
 };
 
 // =================================================================================================
 
 // for logical, integer, and double. complex cannot be compared, character will require specialization
-// logical output can only happen if all inputs are logical
-template<typename T, bool WHICH>
-class RowExtremaWorker : public ParallelWorker
+// Sink is one of the concrete output wrappers, like for RowArithWorker
+template<typename T, bool WHICH, typename Sink = void>
+class RowExtremaWorker : public ExtremaWorker<T>
 {
 public:
     typedef typename std::conditional<WHICH, int, T>::type OUT_T;
 
     RowExtremaWorker(const OperationMetadata& metadata,
                      const ColumnCollection& cc,
-                     OutputWrapper<OUT_T>& ans,
+                     Sink& ans,
                      const Rcpp::List extras)
-        : ParallelWorker(metadata, cc)
+        : ExtremaWorker<T>(metadata, cc, extras)
         , ans_(ans)
-        , comp_op_(parse_comp_op(Rcpp::as<std::string>(extras["comp_op"])))
-        , dummy_parent_visitor_(std::make_shared<InitBooleanVisitor>(true))
-    { }
-
-    virtual thread_local_ptr work_row(std::size_t in_id, std::size_t out_id, thread_local_ptr t_local) override {
-        supported_col_t variant;
-        bool variant_initialized = false;
-        std::shared_ptr<BooleanVisitor> visitor = nullptr;
-        std::shared_ptr<std::string> string_buffer_0 = nullptr;
-        std::shared_ptr<std::string> string_buffer_1 = nullptr;
-
-        for (std::size_t j = 0; j < col_collection_.ncol(); j++) {
-            const supported_col_t& next_variant = col_collection_(in_id, j);
-            bool is_na = boost::apply_visitor(na_visitor_, next_variant);
-
-            if (is_na) {
-                if (metadata.na_action == NaAction::EXCLUDE) {
-                    continue;
-                }
-                else if (std::is_same<OUT_T, int>::value) { // ternary operator causes type problems, compiler optimizations?
-                    variant = NA_INTEGER;
-                }
-                else {
-                    variant = NA_REAL;
-                }
+    {
+        ans_.validate(this->num_ops(), this->comp_ops_.size());
+    }
 
-                variant_initialized = true;
-                break;
-            }
-            else if (!visitor) {
-                const supported_col_t coerced_next = coerce(next_variant, string_buffer_1, col_collection_[j]->is_logical());
-                variant = WHICH ? static_cast<int>(j + 1) : coerced_next;
-                visitor = instantiate_visitor(boost::get<T>(coerced_next));
-            }
-            else {
-                const supported_col_t coerced_next = coerce(next_variant, string_buffer_0, col_collection_[j]->is_logical());
-                bool next_more_extreme = boost::apply_visitor(*visitor, coerced_next);
-                if (next_more_extreme) {
-                    variant = WHICH ? static_cast<int>(j + 1) : coerced_next;
-
-                    if (string_buffer_0) {
-                        // new string instntiated
-                        string_buffer_1 = std::make_shared<std::string>(*string_buffer_0);
-                        visitor = std::make_shared<ComparisonVisitor<boost::string_ref>>(bool_op_,
-                                                                                         comp_op_,
-                                                                                         boost::string_ref(string_buffer_1->c_str()),
-                                                                                         dummy_parent_visitor_);
-                    }
-                    else {
-                        // coerced_next holds a string_ref pointing to an R-allocated string
-                        visitor = instantiate_visitor(boost::get<T>(coerced_next));
-                    }
+protected:
+    virtual void write_block(const RowBlock& block, const ExtremaBuffer<T>& state, WorkerScratch&) override {
+        for (std::size_t k = 0; k < this->comp_ops_.size(); k++) {
+            CompOp comp_op = this->comp_ops_[k];
+            const std::size_t offset = k * block.size;
+
+            auto value = [&](const std::size_t r) {
+                return output(comp_op, state, offset + r);
+            };
+
+            if (block.out_ids) {
+                for (std::size_t r = 0; r < block.size; r++) {
+                    ans_.at(block.out_ids[r], k) = value(r);
                 }
+                continue;
             }
 
-            variant_initialized = true;
+            ans_.fill_block(block.out_begin, k, block.size, value);
         }
+    }
 
-        if (variant_initialized) {
-            ans_[out_id] = boost::get<OUT_T>(variant);
+private:
+    static OUT_T output(const CompOp comp_op, const ExtremaBuffer<T>& state, const std::size_t s) {
+        if (state.flags[s] & EXTREMUM_NA) {
+            return na_output(std::is_same<OUT_T, int>());
+        }
+        else if (state.flags[s] & EXTREMUM_FOUND) {
+            return result(std::integral_constant<bool, WHICH>(), state.values[s], state.which[s]);
         }
         else if (std::is_same<OUT_T, int>::value) {
-            ans_[out_id] = NA_INTEGER;
+            return na_output(std::true_type());
         }
-        else if (comp_op_ == CompOp::LT || comp_op_ == CompOp::LTE) {
-            ans_[out_id] = R_PosInf;
+        else if (comp_op == CompOp::LT || comp_op == CompOp::LTE) {
+            return static_cast<OUT_T>(R_PosInf);
         }
         else {
-            ans_[out_id] = R_NegInf;
+            return static_cast<OUT_T>(R_NegInf);
         }
-
-        return nullptr;
-    }
-private:
-    std::shared_ptr<BooleanVisitor> instantiate_visitor(const T& val) const {
-        return std::make_shared<ComparisonVisitor<T>>(bool_op_,
-                                                      comp_op_,
-                                                      val,
-                                                      dummy_parent_visitor_);
     }
 
-    // https://stackoverflow.com/a/21464113/5793905
-
-    template<typename Q = T>
-    typename std::enable_if<!std::is_same<Q, boost::string_ref>::value, T>::type
-    coerce(const supported_col_t& variant, std::shared_ptr<std::string>&, const bool) const {
-        if (variant.type() == typeid(int)) {
-            return boost::get<int>(variant);
-        }
-        else if (variant.type() == typeid(double)) {
-            return boost::get<double>(variant);
-        }
-
-        throw std::runtime_error("[wiserow] Invalid type passed to RowExtremaWorker. This should not happen."); // nocov
+    // the ternary operator causes type problems
+    static OUT_T na_output(std::true_type) {
+        return static_cast<OUT_T>(NA_INTEGER);
     }
 
-    template<typename Q = T>
-    typename std::enable_if<std::is_same<Q, boost::string_ref>::value, boost::string_ref>::type
-    coerce(const supported_col_t& variant, std::shared_ptr<std::string>& string_buffer, const bool is_logical) {
-        if (variant.type() == typeid(int)) {
-            std::string str = is_logical ? ::wiserow::to_string(boost::get<int>(variant) != 0) :  ::wiserow::to_string(boost::get<int>(variant));
-            string_buffer = std::make_shared<std::string>(str);
-            return boost::string_ref(string_buffer->c_str());
-        }
-        else if (variant.type() == typeid(double)) {
-            string_buffer = std::make_shared<std::string>(::wiserow::to_string(boost::get<double>(variant)));
-            return boost::string_ref(string_buffer->c_str());
-        }
-        else if (variant.type() == typeid(boost::string_ref)) {
-            string_buffer.reset();
-            return boost::get<boost::string_ref>(variant);
-        }
+    static OUT_T na_output(std::false_type) {
+        return static_cast<OUT_T>(NA_REAL);
+    }
 
-        throw std::runtime_error("[wiserow] Invalid type passed to RowExtremaWorker. This should not happen."); // nocov
+    static int result(std::true_type, const T&, const int which) {
+        return which;
     }
 
-    OutputWrapper<OUT_T>& ans_;
-    const CompOp comp_op_;
-    const std::shared_ptr<BooleanVisitor> dummy_parent_visitor_;
+    static T result(std::false_type, const T& val, const int) {
+        return val;
+    }
 
-    const BoolOp bool_op_ = BoolOp::AND;
-    const NAVisitor na_visitor_;
+    Sink& ans_;
 };
 
 // -------------------------------------------------------------------------------------------------
 // SET_STRING_ELT doesn't seem to be thread safe :(
+// so each row records where its extremum came from, and the main thread writes the CHARSXPs
 
 template<>
-class RowExtremaWorker<boost::string_ref, false> : public ParallelWorker
+class RowExtremaWorker<boost::string_ref, false> : public ExtremaWorker<boost::string_ref>
 {
 public:
     RowExtremaWorker(const OperationMetadata& metadata,
                      const ColumnCollection& cc,
                      const Rcpp::List extras);
 
-    static boost::string_ref STRING_REF_NOT_SET;
-
-    virtual thread_local_ptr work_row(std::size_t in_id, std::size_t out_id, thread_local_ptr t_local) override;
+    // only after parallel_for, and only from the main thread
+    SEXP result(const std::size_t out_id, const std::size_t k) const;
 
-    std::vector<boost::string_ref> ans;
+protected:
+    virtual void write_block(const RowBlock& block,
+                             const ExtremaBuffer<boost::string_ref>& state,
+                             WorkerScratch& scratch) override;
 
 private:
-    std::shared_ptr<BooleanVisitor> instantiate_visitor(const boost::string_ref& str_ref);
-    boost::string_ref coerce(const supported_col_t& variant, const bool is_logical);
-
-    const CompOp comp_op_;
-    const std::shared_ptr<BooleanVisitor> dummy_parent_visitor_;
+    SEXP source(const std::size_t in_id, const int which) const;
 
-    std::unordered_set<std::string> temporary_strings_;
-
-    const BoolOp bool_op_ = BoolOp::AND;
-    const NAVisitor na_visitor_;
+    // the input's CHARSXP for each row and extremum, or nullptr if the extremum was a number
+    std::vector<SEXP> charsxps_;
+    std::vector<const char *> formatted_; // numbers as strings, in the threads' arenas
 };
 
 } // namespace wiserow
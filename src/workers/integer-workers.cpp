@@ -2,63 +2,204 @@
 
 namespace wiserow {
 
-BoolTestWorker::BoolTestWorker(const OperationMetadata& metadata,
-                               const ColumnCollection& cc,
-                               OutputWrapper<int>& ans,
-                               const std::shared_ptr<BooleanVisitor>& visitor,
-                               const std::shared_ptr<OutputStrategy<int>>& out_strategy)
+template<typename Strategy, typename Sink>
+BoolTestWorker<Strategy, Sink>::BoolTestWorker(const OperationMetadata& metadata,
+                                               const ColumnCollection& cc,
+                                               Sink& ans,
+                                               const BooleanPredicate& predicate,
+                                               const ValueTest value_test,
+                                               const std::shared_ptr<Strategy>& out_strategy)
     : ParallelWorker(metadata, cc)
     , ans_(ans)
-    , visitor_(visitor)
+    , predicate_(predicate)
+    , value_test_(value_test)
     , out_strategy_(out_strategy)
-{ }
+{
+    ans_.validate(num_ops(), 1);
+}
 
 // -------------------------------------------------------------------------------------------------
 
-ParallelWorker::thread_local_ptr BoolTestWorker::work_row(std::size_t in_id, std::size_t out_id, thread_local_ptr t_local) {
-    std::shared_ptr<OutputStrategy<int>> thread_local_strategy =
-            t_local ? std::static_pointer_cast<OutputStrategy<int>>(t_local) : out_strategy_->clone();
+template<typename Strategy, typename Sink>
+void BoolTestWorker<Strategy, Sink>::work_row(std::size_t in_id, std::size_t out_id, WorkerScratch& scratch) {
+    Strategy *thread_local_strategy = scratch.clone_of(out_strategy_);
 
     thread_local_strategy->reinit();
 
     for (std::size_t j = 0; j < col_collection_.ncol(); j++) {
-        supported_col_t variant = col_collection_(in_id, j);
-        thread_local_strategy->apply(j, variant, boost::apply_visitor(*visitor_, variant));
+        thread_local_strategy->apply(j, col_collection_.visit(in_id, j, predicate_));
 
         if (thread_local_strategy->short_circuit()) {
             break;
         }
     }
 
-    ans_[out_id] = thread_local_strategy->output(metadata, col_collection_.ncol(), false);
-    return thread_local_strategy;
+    ans_.at(out_id, 0) = thread_local_strategy->output(metadata, col_collection_.ncol(), false);
+}
+
+// -------------------------------------------------------------------------------------------------
+
+template<typename Strategy, typename Sink>
+void BoolTestWorker<Strategy, Sink>::work_block(const RowBlock& block, WorkerScratch& scratch) {
+    TallyBuffer& buffer = scratch.state<TallyBuffer>();
+
+    buffer.reset(block.size);
+    test_columns(block, 0, col_collection_.ncol(), buffer);
+    write_block(block, buffer);
+}
+
+template<typename Strategy, typename Sink>
+WorkerThreadLocal *BoolTestWorker<Strategy, Sink>::scan_slab(const RowBlock& block,
+                                                             const std::size_t j_begin,
+                                                             const std::size_t j_end,
+                                                             ScratchArena& arena)
+{
+    TallyBuffer *partial = arena.create<TallyBuffer>(arena);
+
+    partial->reset(block.size);
+    test_columns(block, j_begin, j_end, *partial);
+    return partial;
+}
+
+template<typename Strategy, typename Sink>
+void BoolTestWorker<Strategy, Sink>::merge_slabs(const RowBlock& block,
+                                                 WorkerThreadLocal * const *partials,
+                                                 const std::size_t num_slabs,
+                                                 WorkerScratch& scratch)
+{
+    TallyBuffer& buffer = scratch.state<TallyBuffer>();
+
+    buffer.reset(block.size);
+    buffer.merge(partials, num_slabs);
+    write_block(block, buffer);
+}
+
+template<typename Strategy, typename Sink>
+void BoolTestWorker<Strategy, Sink>::test_columns(const RowBlock& block,
+                                                  const std::size_t j_begin,
+                                                  const std::size_t j_end,
+                                                  TallyBuffer& buffer) const
+{
+    for (std::size_t j = j_begin; j < j_end; j++) {
+        const ColumnSpan& span = col_collection_.span(j);
+
+        switch(span.type()) {
+        case ColumnType::INTEGER: {
+            test_column(span.as<int>(), j, block, buffer);
+            break;
+        }
+        case ColumnType::DOUBLE: {
+            test_column(span.as<double>(), j, block, buffer);
+            break;
+        }
+        case ColumnType::STRING: {
+            test_column(span.as<SEXP>(), j, block, buffer);
+            break;
+        }
+        case ColumnType::COMPLEX: {
+            test_column(span.as<std::complex<double>>(), j, block, buffer);
+            break;
+        }
+        case ColumnType::FACTOR: {
+            test_column(span.as_factor(), j, block, buffer);
+            break;
+        }
+        }
+    }
+}
+
+template<typename Strategy, typename Sink>
+void BoolTestWorker<Strategy, Sink>::write_block(const RowBlock& block, const TallyBuffer& buffer) {
+    const Strategy& strategy = *out_strategy_;
+    const OperationMetadata& block_metadata = metadata;
+    const std::size_t ncol = col_collection_.ncol();
+    const MatchTally *tallies = buffer.tallies.data();
+
+    auto value = [&](const std::size_t r) {
+        return strategy.output(block_metadata, ncol, tallies[r]);
+    };
+
+    if (block.out_ids) {
+        for (std::size_t r = 0; r < block.size; r++) {
+            ans_.at(block.out_ids[r], 0) = value(r);
+        }
+        return;
+    }
+
+    ans_.fill_block(block.out_begin, 0, block.size, value);
+}
+
+// -------------------------------------------------------------------------------------------------
+
+template<typename Strategy, typename Sink>
+template<typename Column>
+void BoolTestWorker<Strategy, Sink>::test_column(const Column& column,
+                                                 const std::size_t j,
+                                                 const RowBlock& block,
+                                                 TallyBuffer& buffer) const
+{
+    scratch_vector<MatchTally>& tallies = buffer.tallies;
+
+    if (block.contiguous) {
+        buffer.matches.resize(block.size);
+        unsigned char *matches = buffer.matches.data();
+
+        if (test_contiguous(value_test_, contiguous_cells(column, block.in_ids[0]), block.size, matches)) {
+            for (std::size_t r = 0; r < block.size; r++) {
+                MatchTally& tally = tallies[r];
+                if (out_strategy_->short_circuit(tally)) continue;
+
+                tally.apply(j, matches[r]);
+            }
+
+            return;
+        }
+    }
+
+    for (std::size_t r = 0; r < block.size; r++) {
+        MatchTally& tally = tallies[r];
+        if (out_strategy_->short_circuit(tally)) continue;
+
+        tally.apply(j, predicate_(visitable(column[block.in_ids[r]])));
+    }
 }
 
 // =================================================================================================
 
-NATestWorker::NATestWorker(const OperationMetadata& metadata,
-                           const ColumnCollection& cc,
-                           OutputWrapper<int>& ans,
-                           const std::shared_ptr<OutputStrategy<int>>& out_strategy)
-    : BoolTestWorker(metadata, cc, ans, BooleanVisitorBuilder().is_na().build(), out_strategy)
+template<typename Strategy, typename Sink>
+NATestWorker<Strategy, Sink>::NATestWorker(const OperationMetadata& metadata,
+                                           const ColumnCollection& cc,
+                                           Sink& ans,
+                                           const std::shared_ptr<Strategy>& out_strategy)
+    : BoolTestWorker<Strategy, Sink>(metadata, cc, ans, BooleanVisitorBuilder().is_na().compile(), ValueTest::IS_NA, out_strategy)
 { }
 
 // =================================================================================================
 
-InfTestWorker::InfTestWorker(const OperationMetadata& metadata,
-                             const ColumnCollection& cc,
-                             OutputWrapper<int>& ans,
-                             const std::shared_ptr<OutputStrategy<int>>& out_strategy)
-    : BoolTestWorker(metadata, cc, ans, BooleanVisitorBuilder().is_inf().build(), out_strategy)
+template<typename Strategy, typename Sink>
+InfTestWorker<Strategy, Sink>::InfTestWorker(const OperationMetadata& metadata,
+                                             const ColumnCollection& cc,
+                                             Sink& ans,
+                                             const std::shared_ptr<Strategy>& out_strategy)
+    : BoolTestWorker<Strategy, Sink>(metadata, cc, ans, BooleanVisitorBuilder().is_inf().compile(), ValueTest::IS_INF, out_strategy)
 { }
 
 // =================================================================================================
 
-FiniteTestWorker::FiniteTestWorker(const OperationMetadata& metadata,
-                                   const ColumnCollection& cc,
-                                   OutputWrapper<int>& ans,
-                                   const std::shared_ptr<OutputStrategy<int>>& out_strategy)
-    : BoolTestWorker(metadata, cc, ans, BooleanVisitorBuilder(BoolOp::AND, true).is_na(true).is_inf(true).build(), out_strategy)
+template<typename Strategy, typename Sink>
+FiniteTestWorker<Strategy, Sink>::FiniteTestWorker(const OperationMetadata& metadata,
+                                                   const ColumnCollection& cc,
+                                                   Sink& ans,
+                                                   const std::shared_ptr<Strategy>& out_strategy)
+    : BoolTestWorker<Strategy, Sink>(metadata, cc, ans, BooleanVisitorBuilder(BoolOp::AND, true).is_na(true).is_inf(true).compile(), ValueTest::IS_FINITE, out_strategy)
 { }
 
+// =================================================================================================
+// the strategies mixed_out.cpp dispatches to
+
+WISEROW_INSTANTIATE_MATCH_TYPES(BoolTestWorker);
+WISEROW_INSTANTIATE_MATCH_TYPES(NATestWorker);
+WISEROW_INSTANTIATE_MATCH_TYPES(InfTestWorker);
+WISEROW_INSTANTIATE_MATCH_TYPES(FiniteTestWorker);
+
 } // namespace wiserow
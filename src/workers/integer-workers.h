@@ -16,122 +16,284 @@ namespace wiserow {
 
 // =================================================================================================
 
+/*
+ * Strategy is one of the final OutputStrategy classes, and Sink one of the final output wrappers
+ * of logical or integer results, both chosen once per call in mixed_out.cpp. Workers call
+ * Sink::validate() once and then write with its non-virtual at() and fill_block().
+ */
+
+typedef VectorOutputWrapper<LGLSXP, int> LogicalVectorSink;
+typedef VectorOutputWrapper<INTSXP, int> IntegerVectorSink;
+typedef ListOutputWrapper<LGLSXP, int> LogicalListSink;
+typedef ListOutputWrapper<INTSXP, int> IntegerListSink;
+typedef DataFrameOutputWrapper<LGLSXP, int> LogicalDataFrameSink;
+typedef DataFrameOutputWrapper<INTSXP, int> IntegerDataFrameSink;
+typedef MatrixOutputWrapper<LGLSXP, int> LogicalMatrixSink;
+typedef MatrixOutputWrapper<INTSXP, int> IntegerMatrixSink;
+
+// explicit instantiations for everything mixed_out.cpp dispatches to
+#define WISEROW_INSTANTIATE_SINKS(WORKER, STRATEGY)          \
+    template class WORKER<STRATEGY, LogicalVectorSink>;      \
+    template class WORKER<STRATEGY, IntegerVectorSink>;      \
+    template class WORKER<STRATEGY, LogicalListSink>;        \
+    template class WORKER<STRATEGY, IntegerListSink>;        \
+    template class WORKER<STRATEGY, LogicalDataFrameSink>;   \
+    template class WORKER<STRATEGY, IntegerDataFrameSink>;   \
+    template class WORKER<STRATEGY, LogicalMatrixSink>;      \
+    template class WORKER<STRATEGY, IntegerMatrixSink>
+
+#define WISEROW_INSTANTIATE_MATCH_TYPES(WORKER)                               \
+    WISEROW_INSTANTIATE_SINKS(WORKER, BulkBoolStrategy<BulkBoolOp::ALL>);     \
+    WISEROW_INSTANTIATE_SINKS(WORKER, BulkBoolStrategy<BulkBoolOp::ANY>);     \
+    WISEROW_INSTANTIATE_SINKS(WORKER, BulkBoolStrategy<BulkBoolOp::NONE>);    \
+    WISEROW_INSTANTIATE_SINKS(WORKER, WhichFirstStrategy);                    \
+    WISEROW_INSTANTIATE_SINKS(WORKER, CountStrategy)
+
+// -------------------------------------------------------------------------------------------------
+
+template<typename Strategy, typename Sink>
 class BoolTestWorker : public ParallelWorker
 {
 public:
     BoolTestWorker(const OperationMetadata& metadata,
                    const ColumnCollection& cc,
-                   OutputWrapper<int>& ans,
-                   const std::shared_ptr<BooleanVisitor>& visitor,
-                   const std::shared_ptr<OutputStrategy<int>>& out_strategy);
-
-    virtual thread_local_ptr work_row(std::size_t in_id, std::size_t out_id, thread_local_ptr t_local) override;
+                   Sink& ans,
+                   const BooleanPredicate& predicate,
+                   const ValueTest value_test,
+                   const std::shared_ptr<Strategy>& out_strategy);
+
+    virtual void work_row(std::size_t in_id, std::size_t out_id, WorkerScratch& scratch) override;
+
+protected:
+    virtual bool supports_blocks() const override { return true; }
+    virtual void work_block(const RowBlock& block, WorkerScratch& scratch) override;
+
+    virtual bool supports_column_split() const override { return true; }
+    virtual WorkerThreadLocal *scan_slab(const RowBlock& block,
+                                         const std::size_t j_begin,
+                                         const std::size_t j_end,
+                                         ScratchArena& arena) override;
+    virtual void merge_slabs(const RowBlock& block,
+                             WorkerThreadLocal * const *partials,
+                             const std::size_t num_slabs,
+                             WorkerScratch& scratch) override;
+
+    // mostly vectorized, and strings are only compared to NA_STRING
+    virtual double cell_cost(const ColumnType) const override { return 0.5; }
 
 private:
-    OutputWrapper<int>& ans_;
-    const std::shared_ptr<BooleanVisitor> visitor_;
-    const std::shared_ptr<OutputStrategy<int>> out_strategy_;
+    void test_columns(const RowBlock& block, const std::size_t j_begin, const std::size_t j_end, TallyBuffer& buffer) const;
+
+    template<typename Column>
+    void test_column(const Column& column, const std::size_t j, const RowBlock& block, TallyBuffer& buffer) const;
+
+    void write_block(const RowBlock& block, const TallyBuffer& buffer);
+
+    Sink& ans_;
+    const BooleanPredicate predicate_;
+    const ValueTest value_test_; // what predicate_ checks, for the vectorized kernels
+    const std::shared_ptr<Strategy> out_strategy_;
 };
 
 // =================================================================================================
 
-class NATestWorker : public BoolTestWorker
+template<typename Strategy, typename Sink>
+class NATestWorker : public BoolTestWorker<Strategy, Sink>
 {
 public:
     NATestWorker(const OperationMetadata& metadata,
                  const ColumnCollection& cc,
-                 OutputWrapper<int>& ans,
-                 const std::shared_ptr<OutputStrategy<int>>& out_strategy);
+                 Sink& ans,
+                 const std::shared_ptr<Strategy>& out_strategy);
 };
 
 // =================================================================================================
 
-class InfTestWorker : public BoolTestWorker
+template<typename Strategy, typename Sink>
+class InfTestWorker : public BoolTestWorker<Strategy, Sink>
 {
 public:
     InfTestWorker(const OperationMetadata& metadata,
                   const ColumnCollection& cc,
-                  OutputWrapper<int>& ans,
-                  const std::shared_ptr<OutputStrategy<int>>& out_strategy);
+                  Sink& ans,
+                  const std::shared_ptr<Strategy>& out_strategy);
 };
 
 // =================================================================================================
 
-class FiniteTestWorker : public BoolTestWorker
+template<typename Strategy, typename Sink>
+class FiniteTestWorker : public BoolTestWorker<Strategy, Sink>
 {
 public:
     FiniteTestWorker(const OperationMetadata& metadata,
                      const ColumnCollection& cc,
-                     OutputWrapper<int>& ans,
-                     const std::shared_ptr<OutputStrategy<int>>& out_strategy);
+                     Sink& ans,
+                     const std::shared_ptr<Strategy>& out_strategy);
 };
 
 // =================================================================================================
 
+template<typename Strategy, typename Sink>
 class CompBasedWorker : public ParallelWorker
 {
 public:
     CompBasedWorker(const OperationMetadata& metadata,
                     const ColumnCollection& cc,
-                    OutputWrapper<int>& ans,
+                    Sink& ans,
                     const SEXP& comp_op,
                     const Rcpp::List& target_vals,
-                    const std::shared_ptr<OutputStrategy<int>>& out_strategy);
+                    const std::shared_ptr<Strategy>& out_strategy);
 
-    virtual thread_local_ptr work_row(std::size_t in_id, std::size_t out_id, thread_local_ptr t_local) override;
+    virtual void work_row(std::size_t in_id, std::size_t out_id, WorkerScratch& scratch) override;
+
+protected:
+    virtual bool supports_blocks() const override { return true; }
+    virtual void work_block(const RowBlock& block, WorkerScratch& scratch) override;
+
+    virtual bool supports_column_split() const override;
+    virtual WorkerThreadLocal *scan_slab(const RowBlock& block,
+                                         const std::size_t j_begin,
+                                         const std::size_t j_end,
+                                         ScratchArena& arena) override;
+    virtual void merge_slabs(const RowBlock& block,
+                             WorkerThreadLocal * const *partials,
+                             const std::size_t num_slabs,
+                             WorkerScratch& scratch) override;
 
 private:
-    const NAVisitor na_visitor_;
+    void compare_columns(const RowBlock& block,
+                         const std::size_t j_begin,
+                         const std::size_t j_end,
+                         scratch_vector<MatchTally>& tallies) const;
+
+    void write_block(const RowBlock& block, const TallyBuffer& buffer);
+
+    template<typename Column>
+    void compare_column(const Column& column,
+                        const std::size_t j,
+                        const RowBlock& block,
+                        scratch_vector<MatchTally>& tallies,
+                        const char *logical_vs_char_target) const;
 
-    OutputWrapper<int>& ans_;
+    void compare_column(const FactorColumn& column,
+                        const std::size_t j,
+                        const RowBlock& block,
+                        scratch_vector<MatchTally>& tallies,
+                        const char *) const;
+
+    bool na_result(const std::size_t j, const RowBlock& block, scratch_vector<MatchTally>& tallies) const;
+
+    template<typename T>
+    bool compare(const T& val, const std::size_t j, const BooleanPredicate& predicate, const char *logical_vs_char_target) const;
+
+    bool compare(const SEXP& val, const std::size_t j, const BooleanPredicate& predicate, const char *) const;
+
+    bool compare(const int& val, const std::size_t j, const BooleanPredicate& predicate, const char *logical_vs_char_target) const;
+
+    const BooleanPredicate is_na_;
+
+    Sink& ans_;
     const CompOp comp_op_;
-    const std::shared_ptr<OutputStrategy<int>> out_strategy_;
+    const std::shared_ptr<Strategy> out_strategy_;
 
-    std::vector<std::shared_ptr<BooleanVisitor>> visitors_;
+    std::vector<BooleanPredicate> predicates_;
     std::vector<bool> na_targets_;
+    bool any_complex_target_ = false;
 
     // sigh, for case TRUE == "TRUE"
     std::vector<char *> char_targets_;
     const ComparisonOperator comp_operator_;
+
+    // per column, only filled for factors
+    std::vector<LevelTable> level_tables_;
+
+    // per target, only filled for strings if comp_op_ is == or !=
+    std::vector<CharsxpSet> charsxp_targets_;
 };
 
 // =================================================================================================
 
+template<typename Strategy, typename Sink>
 class InSetWorker : public ParallelWorker
 {
 public:
     InSetWorker(const OperationMetadata& metadata,
                 const ColumnCollection& cc,
-                OutputWrapper<int>& ans,
+                Sink& ans,
                 const Rcpp::List& target_sets,
                 const bool negate,
-                const std::shared_ptr<OutputStrategy<int>>& out_strategy);
+                const std::shared_ptr<Strategy>& out_strategy);
 
-    virtual thread_local_ptr work_row(std::size_t in_id, std::size_t out_id, thread_local_ptr t_local) override;
+    virtual void work_row(std::size_t in_id, std::size_t out_id, WorkerScratch& scratch) override;
+
+protected:
+    virtual bool supports_tiles() const override { return true; }
+    virtual void work_tile_row(const TileRow& row, std::size_t out_id, WorkerScratch& scratch) override;
+
+    // a hash lookup per cell
+    virtual double cell_cost(const ColumnType type) const override {
+        return 2 * ParallelWorker::cell_cost(type);
+    }
 
 private:
-    OutputWrapper<int>& ans_;
-    const std::shared_ptr<OutputStrategy<int>> out_strategy_;
+    template<typename Row>
+    void work_cells(const Row& row, const std::size_t out_id, WorkerScratch& scratch);
+
+    Sink& ans_;
+    const bool negate_;
+    const std::shared_ptr<Strategy> out_strategy_;
+
+    // compiled once, then only read by all threads
+    std::vector<TargetSet> target_sets_;
 
-    std::vector<std::shared_ptr<BooleanVisitor>> visitors_;
-    std::vector<bool> char_targets_;
+    // per column, only filled for factors: whether each level is in the target set
+    std::vector<LevelTable> level_tables_;
 };
 
 // =================================================================================================
 
+// each thread reuses one visitor for all its rows
+class DuplicatedBuffer : public WorkerThreadLocal
+{
+public:
+    DuplicatedBuffer(ScratchArena&) {}
+
+    DuplicatedVisitor visitor;
+};
+
+// -------------------------------------------------------------------------------------------------
+
+// with IdentityStrategy, there is one result per column instead of one per row
+
+template<typename Strategy, typename Sink>
 class DuplicatedWorker : public ParallelWorker
 {
 public:
     DuplicatedWorker(const OperationMetadata& metadata,
                      const ColumnCollection& cc,
-                     OutputWrapper<int>& ans,
-                     const std::shared_ptr<OutputStrategy<int>>& out_strategy);
+                     Sink& ans,
+                     const std::shared_ptr<Strategy>& out_strategy);
+
+    virtual void work_row(std::size_t in_id, std::size_t out_id, WorkerScratch& scratch) override;
 
-    virtual thread_local_ptr work_row(std::size_t in_id, std::size_t out_id, thread_local_ptr t_local) override;
+protected:
+    virtual bool supports_tiles() const override { return true; }
+    virtual void work_tile_row(const TileRow& row, std::size_t out_id, WorkerScratch& scratch) override;
+
+    // a hash table insertion per cell, and promotions may rehash the whole row
+    virtual double cell_cost(const ColumnType type) const override {
+        return 4 * ParallelWorker::cell_cost(type);
+    }
 
 private:
-    OutputWrapper<int>& ans_;
-    const std::shared_ptr<OutputStrategy<int>> out_strategy_;
+    template<typename Row>
+    void work_cells(const Row& row, const std::size_t out_id, WorkerScratch& scratch);
+
+    template<typename Row>
+    bool visit(const Row& row, const std::size_t j, DuplicatedVisitor& visitor) const;
+
+    Sink& ans_;
+    const std::shared_ptr<Strategy> out_strategy_;
 };
 
 } // namespace wiserow
@@ -3,12 +3,79 @@
 
 #include <cstddef> // size_t
 #include <memory>
+#include <vector>
 
 #include "../core.h"
 #include "../utils.h"
 
 namespace wiserow {
 
+// what a row boils down to in column-at-a-time mode, where there is no per-row strategy state
+struct MatchTally
+{
+    void reinit() {
+        matches = 0;
+        applied = 0;
+        first_match = -1;
+        any_na = false;
+    }
+
+    void apply(const std::size_t col, const bool match_flag) {
+        if (match_flag) {
+            if (first_match < 0) first_match = static_cast<int>(col);
+            matches++;
+        }
+
+        applied++;
+    }
+
+    // what other saw in later columns, see ParallelWorker's column-parallel mode
+    void merge(const MatchTally& other) {
+        if (first_match < 0) first_match = other.first_match;
+        matches += other.matches;
+        applied += other.applied;
+        any_na = any_na || other.any_na;
+    }
+
+    int matches;
+    int applied;
+    int first_match;
+    bool any_na;
+};
+
+// -------------------------------------------------------------------------------------------------
+
+class TallyBuffer : public WorkerThreadLocal
+{
+public:
+    TallyBuffer(ScratchArena& arena)
+        : tallies(arena)
+        , matches(arena)
+    { }
+
+    void reset(const std::size_t size) {
+        tallies.resize(size);
+        for (MatchTally& tally : tallies) {
+            tally.reinit();
+        }
+    }
+
+    // partials are TallyBuffers of consecutive slabs of columns for the same rows
+    void merge(WorkerThreadLocal * const *partials, const std::size_t num_partials) {
+        for (std::size_t s = 0; s < num_partials; s++) {
+            const scratch_vector<MatchTally>& other = static_cast<const TallyBuffer *>(partials[s])->tallies;
+            for (std::size_t r = 0; r < tallies.size(); r++) {
+                tallies[r].merge(other[r]);
+            }
+        }
+    }
+
+    scratch_vector<MatchTally> tallies;
+    scratch_vector<unsigned char> matches; // per-row results of a whole column
+};
+
+// =================================================================================================
+
 template<typename T>
 class OutputStrategy : public WorkerThreadLocal
 {
@@ -18,59 +85,179 @@ public:
     virtual void reinit() {} // nocov
     virtual bool short_circuit() { return false; }
 
-    virtual void apply(const std::size_t col, const supported_col_t& variant, const bool match_flag) = 0;
+    virtual void apply(const std::size_t col, const bool match_flag) = 0;
     virtual T output(const OperationMetadata& metadata, const std::size_t ncol, const bool any_na) = 0;
 
-    virtual std::shared_ptr<OutputStrategy<T>> clone() = 0;
+    // equivalents for column-at-a-time mode, these must not modify the strategy
+    virtual bool short_circuit(const MatchTally&) const { return false; }
+    virtual T output(const OperationMetadata& metadata, const std::size_t ncol, const MatchTally& tally) const = 0;
+
+    // copies live in the calling thread's arena
+    virtual OutputStrategy<T> *clone(ScratchArena& arena) const = 0;
 };
 
 // -------------------------------------------------------------------------------------------------
 
-class IdentityStrategy : public OutputStrategy<int>
+/*
+ * The concrete strategies are final, and BulkBoolStrategy takes its operation as a template
+ * parameter, so that workers that take their strategy as a template parameter (see mixed_out.cpp)
+ * can inline apply() and short_circuit() in their loops instead of calling them through the vtable.
+ */
+
+// for workers that write one result per column, which check for it at compile time and never call it
+class IdentityStrategy final : public OutputStrategy<int>
 {
-    virtual void apply(const std::size_t, const supported_col_t&, const bool) override;
-    virtual int output(const OperationMetadata&, const std::size_t, const bool) override;
+public:
+    // nocov start
+    virtual void apply(const std::size_t, const bool) override {
+        throw "IdentityStrategy's apply() should not be called.";
+    }
+
+    virtual int output(const OperationMetadata&, const std::size_t, const bool) override {
+        throw "IdentityStrategy's output() should not be called.";
+    }
+
+    virtual int output(const OperationMetadata&, const std::size_t, const MatchTally&) const override {
+        throw "IdentityStrategy's output() should not be called.";
+    }
 
-    virtual std::shared_ptr<OutputStrategy<int>> clone() override;
+    virtual OutputStrategy<int> *clone(ScratchArena&) const override {
+        return nullptr;
+    }
+    // nocov end
 };
 
 // -------------------------------------------------------------------------------------------------
 
-class BulkBoolStrategy : public OutputStrategy<int>
+template<BulkBoolOp Op>
+class BulkBoolStrategy final : public OutputStrategy<int>
 {
 public:
-    BulkBoolStrategy(const BulkBoolOp& bb_op, const NaAction& na_action);
+    BulkBoolStrategy(const NaAction na_action)
+        : na_action_(na_action)
+        , flag_(INIT)
+    { }
+
+    virtual void reinit() override {
+        flag_ = INIT;
+    }
+
+    virtual bool short_circuit() override {
+        return flag_short_circuits(flag_);
+    }
 
-    virtual void reinit() override;
-    virtual bool short_circuit() override;
+    virtual void apply(const std::size_t, const bool match_flag) override {
+        flag_ = Op == BulkBoolOp::ALL ? flag_ && match_flag : flag_ || match_flag;
+    }
 
-    virtual void apply(const std::size_t, const supported_col_t&, const bool match_flag) override;
-    virtual int output(const OperationMetadata&, const std::size_t ncol, const bool any_na) override;
+    virtual int output(const OperationMetadata&, const std::size_t ncol, const bool any_na) override {
+        return flag_output(ncol, flag_, any_na);
+    }
 
-    virtual std::shared_ptr<OutputStrategy<int>> clone() override;
+    virtual bool short_circuit(const MatchTally& tally) const override {
+        return flag_short_circuits(tally_flag(tally));
+    }
+
+    virtual int output(const OperationMetadata&, const std::size_t ncol, const MatchTally& tally) const override {
+        return flag_output(ncol, tally_flag(tally), tally.any_na);
+    }
+
+    virtual OutputStrategy<int> *clone(ScratchArena& arena) const override {
+        return arena.create<BulkBoolStrategy<Op>>(na_action_);
+    }
 
 private:
-    const BulkBoolOp bb_op_;
-    const LogicalOperator logical_operator_;
+    static const bool INIT = Op == BulkBoolOp::ALL;
+
+    bool flag_short_circuits(const bool flag) const {
+        // maybe don't break because R's all/any still check all values for NA when na.rm = FALSE
+        if (na_action_ == NaAction::EXCLUDE) {
+            return Op == BulkBoolOp::ALL ? !flag : flag;
+        }
+
+        return false;
+    }
+
+    int flag_output(const std::size_t ncol, const bool flag, const bool any_na) const {
+        switch(Op) {
+        case BulkBoolOp::ALL: {
+            if (ncol > 0) {
+                if (flag && any_na) {
+                    return NA_INTEGER;
+                }
+                else {
+                    return flag;
+                }
+            }
+            else {
+                return 0;
+            }
+        }
+        case BulkBoolOp::ANY: {
+            if (!flag && any_na) {
+                return NA_INTEGER;
+            }
+            else {
+                return flag;
+            }
+        }
+        case BulkBoolOp::NONE: {
+            if (!flag && any_na) {
+                return NA_INTEGER;
+            }
+            else {
+                return !flag;
+            }
+        }
+        }
+
+        return NA_INTEGER; // nocov
+    }
+
+    // the flag AND/OR would have accumulated
+    bool tally_flag(const MatchTally& tally) const {
+        if (Op == BulkBoolOp::ALL) {
+            return tally.matches == tally.applied;
+        }
+        else {
+            return tally.matches > 0;
+        }
+    }
+
     const NaAction na_action_;
-    const bool init_;
     bool flag_;
 };
 
 // -------------------------------------------------------------------------------------------------
 
-class WhichFirstStrategy : public OutputStrategy<int>
+class WhichFirstStrategy final : public OutputStrategy<int>
 {
 public:
     WhichFirstStrategy();
 
-    virtual void reinit() override;
-    virtual bool short_circuit() override;
+    virtual void reinit() override {
+        which_ = -1;
+    }
+
+    virtual bool short_circuit() override {
+        return which_ >= 0;
+    }
+
+    virtual void apply(const std::size_t col, const bool match_flag) override {
+        if (match_flag) {
+            which_ = col;
+        }
+    }
 
-    virtual void apply(const std::size_t col, const supported_col_t&, const bool match_flag) override;
     virtual int output(const OperationMetadata& metadata, const std::size_t, const bool) override;
 
-    virtual std::shared_ptr<OutputStrategy<int>> clone() override;
+    virtual bool short_circuit(const MatchTally& tally) const override {
+        return tally.first_match >= 0;
+    }
+
+    virtual int output(const OperationMetadata&, const std::size_t, const MatchTally& tally) const override;
+
+    virtual OutputStrategy<int> *clone(ScratchArena& arena) const override;
 
 private:
     int which_;
@@ -78,17 +265,25 @@ private:
 
 // -------------------------------------------------------------------------------------------------
 
-class CountStrategy : public OutputStrategy<int>
+class CountStrategy final : public OutputStrategy<int>
 {
 public:
     CountStrategy();
 
-    virtual void reinit() override;
+    virtual void reinit() override {
+        count_ = 0;
+    }
+
+    virtual void apply(const std::size_t, const bool match_flag) override {
+        if (match_flag) {
+            count_++;
+        }
+    }
 
-    virtual void apply(const std::size_t, const supported_col_t&, const bool match_flag) override;
     virtual int output(const OperationMetadata&, const std::size_t, const bool any_na) override;
+    virtual int output(const OperationMetadata&, const std::size_t, const MatchTally& tally) const override;
 
-    virtual std::shared_ptr<OutputStrategy<int>> clone() override;
+    virtual OutputStrategy<int> *clone(ScratchArena& arena) const override;
 
 private:
     int count_;